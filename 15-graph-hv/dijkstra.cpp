@@ -16,8 +16,13 @@
 */
  
 #include <queue>
+#include <array>
 #include <algorithm>
 #include <iterator>
+#include <exception>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
 
 #include "graph.hpp"
 
@@ -87,43 +92,271 @@ struct Entry
    bool operator>(Entry const& b) const { return dist_ > b.dist_; };
 };
 
-/** Dijkstras Algorithm.
+/* The queues all have the same interface:
+ *    push(node, dist)  node has got the (smaller) label dist
+ *    pop()             remove an entry with the smallest label
+ *    empty()
+ * Except for the indexed heap, push() adds another entry and pop() may return
+ * entries with an outdated label, which the caller skips.
  */
-void Graph::dijkstra(
-   node_no_t const    start,
-   vector<double>&    dist,
-   vector<node_no_t>& pred,
-   bool const         initialize) const
+
+/** Binary heap with lazy deletion.
+ */
+class BinaryHeapQueue
 {
-   using std::fill;
-   using std::priority_queue;
-   using std::greater;
-   
-   assert(start       <  node_count());
-   assert(dist.size() == node_count());
-   assert(pred.size() == node_count());
+private:
+   std::priority_queue<Entry, vector<Entry>, std::greater<Entry>> heap_;
 
-   // Shall we initialize distances and predecessors?
-   if (initialize)  
+public:
+   void  push(Graph::node_no_t const node_no, double const dist) { heap_.emplace(Entry(node_no, dist)); };
+   bool         empty() const { return heap_.empty(); };
+   Entry const& top()   const { return heap_.top(); };
+   Entry        pop()
    {
-      fill(dist.begin(), dist.end(), infinite_dist);
-      fill(pred.begin(), pred.end(), invalid_node);
+      Entry const entry = heap_.top();
+
+      heap_.pop();
+
+      return entry;
    }
-   dist[start] = 0;
+};
+
+/** Radix heap (Ahuja, Mehlhorn, Orlin, Tarjan).
+ *  It only needs monotone keys, which holds for Dijkstra. Non-negative doubles
+ *  compare like their bit patterns as unsigned integers, so the 64 bit key is the
+ *  bit pattern of the label. Bucket b holds the keys that differ from the last
+ *  popped key first in bit b - 1, bucket 0 the keys equal to it.
+ */
+class RadixHeapQueue
+{
+private:
+   using key_t = std::uint64_t;
+
+   struct Item
+   {
+      key_t            key;
+      Graph::node_no_t node_no;
+   };
+
+   std::array<vector<Item>, 65> buckets_;
+   key_t                        last_ = 0;
+   size_t                       size_ = 0;
+
+   static key_t to_key(double const dist)
+   {
+      key_t key;
+
+      std::memcpy(&key, &dist, sizeof(key));
+
+      return key;
+   }
+   static double to_dist(key_t const key)
+   {
+      double dist;
+
+      std::memcpy(&dist, &key, sizeof(dist));
+
+      return dist;
+   }
+   size_t bucket(key_t const key) const
+   {
+      return key == last_ ? 0 : static_cast<size_t>(64 - __builtin_clzll(key ^ last_));
+   }
+
+public:
+   void push(Graph::node_no_t const node_no, double const dist)
+   {
+      assert(dist >= 0.0);
+
+      key_t const key = to_key(dist);
+
+      assert(key >= last_);
+
+      buckets_[bucket(key)].push_back({ key, node_no });
+      size_++;
+   }
+   bool  empty() const { return size_ == 0; };
+   Entry pop()
+   {
+      assert(size_ > 0);
+
+      // Refill bucket 0 from the first non empty bucket, all its keys go to smaller buckets
+      if (buckets_[0].empty())
+      {
+         size_t b = 1;
+
+         while(buckets_[b].empty())
+            b++;
+
+         last_ = std::min_element(buckets_[b].begin(), buckets_[b].end(),
+            [](Item const& x, Item const& y) { return x.key < y.key; })->key;
+
+         for(auto const& item : buckets_[b])
+            buckets_[bucket(item.key)].push_back(item);
+
+         buckets_[b].clear();
+      }
+      Item const item = buckets_[0].back();
+
+      buckets_[0].pop_back();
+      size_--;
+
+      return Entry(item.node_no, to_dist(item.key));
+   }
+};
+
+/** Dial's bucket queue for integral edge lengths up to max_length.
+ *  All labels in the queue are between the current minimum and the minimum
+ *  plus max_length, therefore max_length + 1 buckets used as a ring suffice.
+ */
+class DialQueue
+{
+private:
+   vector<vector<Graph::node_no_t>> buckets_;
+   std::uint64_t                    current_ = 0; //< Smallest label in the queue
+   size_t                           size_    = 0;
+
+public:
+   explicit DialQueue(std::uint64_t const max_length) : buckets_(max_length + 1) {};
+
+   void push(Graph::node_no_t const node_no, double const dist)
+   {
+      auto const label = static_cast<std::uint64_t>(dist);
+
+      assert(label >= current_ and label - current_ < buckets_.size());
+
+      buckets_[label % buckets_.size()].push_back(node_no);
+      size_++;
+   }
+   bool  empty() const { return size_ == 0; };
+   Entry pop()
+   {
+      assert(size_ > 0);
+
+      while(buckets_[current_ % buckets_.size()].empty())
+         current_++;
+
+      auto& bucket = buckets_[current_ % buckets_.size()];
+
+      Graph::node_no_t const node_no = bucket.back();
+
+      bucket.pop_back();
+      size_--;
 
-   priority_queue<Entry, vector<Entry>, greater<Entry>> queue;
+      return Entry(node_no, static_cast<double>(current_));
+   }
+};
+
+/** Indexed d-ary heap with decrease-key, each node is at most once in the heap.
+ *  The keys are the current labels in dist.
+ */
+class DaryHeapQueue
+{
+private:
+   static constexpr size_t arity = 4;
+
+   vector<double> const&    dist_;
+   vector<Graph::node_no_t> heap_;
+   vector<Graph::node_no_t> position_; //< Index of the node in heap_, invalid_node if not in the heap
+
+   void sift_up(size_t i)
+   {
+      Graph::node_no_t const node_no = heap_[i];
+
+      while(i > 0)
+      {
+         size_t const parent = (i - 1) / arity;
+
+         if (not (dist_[heap_[parent]] > dist_[node_no]))
+            break;
+
+         heap_[i]            = heap_[parent];
+         position_[heap_[i]] = static_cast<Graph::node_no_t>(i);
+         i                   = parent;
+      }
+      heap_[i]           = node_no;
+      position_[node_no] = static_cast<Graph::node_no_t>(i);
+   }
+   void sift_down(size_t i)
+   {
+      Graph::node_no_t const node_no = heap_[i];
+      size_t           const size    = heap_.size();
+
+      for(;;)
+      {
+         size_t const first = i * arity + 1;
+
+         if (first >= size)
+            break;
+
+         size_t const last = std::min(first + arity, size);
+         size_t       best = first;
+
+         for(size_t c = first + 1; c < last; c++)
+            if (dist_[heap_[c]] < dist_[heap_[best]])
+               best = c;
+
+         if (not (dist_[heap_[best]] < dist_[node_no]))
+            break;
+
+         heap_[i]            = heap_[best];
+         position_[heap_[i]] = static_cast<Graph::node_no_t>(i);
+         i                   = best;
+      }
+      heap_[i]           = node_no;
+      position_[node_no] = static_cast<Graph::node_no_t>(i);
+   }
+
+public:
+   explicit DaryHeapQueue(vector<double> const& dist) : dist_(dist), position_(dist.size(), Graph::invalid_node) {};
+
+   // dist_[node_no] is already set to dist
+   void push(Graph::node_no_t const node_no, double const dist)
+   {
+      assert(dist_[node_no] == dist); //lint !e777
+
+      if (position_[node_no] == Graph::invalid_node)
+      {
+         heap_.push_back(node_no);
+         sift_up(heap_.size() - 1);
+      }
+      else
+         sift_up(position_[node_no]);
+   }
+   bool  empty() const { return heap_.empty(); };
+   Entry pop()
+   {
+      Graph::node_no_t const node_no = heap_.front();
+
+      position_[node_no] = Graph::invalid_node;
+
+      if (heap_.size() > 1)
+      {
+         heap_.front() = heap_.back();
+         heap_.pop_back();
+         sift_down(0);
+      }
+      else
+         heap_.pop_back();
+
+      return Entry(node_no, dist_[node_no]);
+   }
+};
 
+/** The label setting loop, the same for all queues.
+ */
+template <typename Queue>
+void label_setting(Graph const& g, Graph::node_no_t const start, vector<double>& dist, vector<Graph::node_no_t>& pred, Queue& queue)
+{
    // Put starting node into the queue.
-   queue.emplace(Entry(start, 0.0));
+   queue.push(start, 0.0);
    
    // Once the queue is empty, we are finished.
    while(not queue.empty())
    {
       // Which node are we processing next?
-      Entry    const entry = queue.top();
-      node_no_t const tail = entry.node_no_;
-
-      queue.pop();
+      Entry            const entry = queue.pop();
+      Graph::node_no_t const tail  = entry.node_no_;
 
       // Already done node? Ignore!
       if (entry.dist_ > dist[tail])
@@ -131,10 +364,10 @@ void Graph::dijkstra(
 
       /* Look through neighbors and correct all nodes where we can go to.
        */
-      for(auto neighbor : get_node(tail).adjacent_nodes())
+      for(auto neighbor : g.get_node(tail).adjacent_nodes())
       {
-         node_no_t const head   = neighbor.node_no();
-         double    const weight = neighbor.dist() + dist[tail];
+         Graph::node_no_t const head   = neighbor.node_no();
+         double           const weight = neighbor.dist() + dist[tail];
 
          assert(neighbor.dist() >= 0);
          
@@ -148,26 +381,333 @@ void Graph::dijkstra(
             pred[head] = tail;
             dist[head] = weight;
 
-            queue.emplace(Entry(head, weight));
+            queue.push(head, weight);
          }
       }
    }
+}
+
+/** Longest edge, if all edge lengths are non-negative integers that fit a DialQueue.
+ *  Otherwise Dial's algorithm cannot be used and an exception is thrown.
+ *  The DialQueue has one bucket per length and scans empty buckets, so longer edges
+ *  are better served by the radix heap.
+ */
+std::uint64_t Graph::max_integral_length() const
+{
+   constexpr std::uint64_t max_buckets = 1 << 16;
+
+   double max_length = 0.0;
+
+   for(arc_no_t a = 0; a < arc_count(); a++)
+   {
+      double const length = dists_[a];
+
+      if (not (length >= 0.0 and length <= static_cast<double>(max_buckets) and length == std::floor(length))) //lint !e777
+         throw std::runtime_error("Dial's algorithm needs integral edge lengths from 0 to " + std::to_string(max_buckets));
+
+      max_length = std::max(max_length, length);
+   }
+   return static_cast<std::uint64_t>(max_length);
+}
+
+/** Dijkstras Algorithm.
+ *  \param queue Priority queue to use, see DijkstraQueue.
+ */
+void Graph::dijkstra(
+   node_no_t const     start,
+   vector<double>&     dist,
+   vector<node_no_t>&  pred,
+   bool const          initialize,
+   DijkstraQueue const queue) const
+{
+   using std::fill;
+   
+   assert(start       <  node_count());
+   assert(dist.size() == node_count());
+   assert(pred.size() == node_count());
+
+   // Shall we initialize distances and predecessors?
+   if (initialize)  
+   {
+      fill(dist.begin(), dist.end(), infinite_dist);
+      fill(pred.begin(), pred.end(), invalid_node);
+   }
+   dist[start] = 0;
+
+   switch(queue)
+   {
+   case DijkstraQueue::binary_heap :
+   {
+      BinaryHeapQueue q;
+      label_setting(*this, start, dist, pred, q);
+      break;
+   }
+   case DijkstraQueue::radix_heap :
+   {
+      RadixHeapQueue q;
+      label_setting(*this, start, dist, pred, q);
+      break;
+   }
+   case DijkstraQueue::dial :
+   {
+      DialQueue q(max_integral_length());
+      label_setting(*this, start, dist, pred, q);
+      break;
+   }
+   case DijkstraQueue::dary_heap :
+   {
+      DaryHeapQueue q(dist);
+      label_setting(*this, start, dist, pred, q);
+      break;
+   }
+   }
    // Postcondition
    assert(path_is_a_tree(start, pred, false));
    assert(is_shortest_path_tree(start, dist, pred));
 }
 
-/*
- * This code is free software; you can redistribute it and/or
- * modify it under the terms of the GNU Lesser General Public License
- * as published by the Free Software Foundation; either version 3
- * of the License, or (at your option) any later version.
- * 
- * This program is distributed in the hope that it will be useful,
- * but WITHOUT ANY WARRANTY; without even the implied warranty of
- * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
- * GNU Lesser General Public License for more details.
- *
- * You should have received a copy of the GNU General Public License
- * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/** Path from start to end along pred, which leads from end back to start.
+ */
+static vector<Graph::node_no_t> build_path(
+   Graph::node_no_t                const  start,
+   Graph::node_no_t                const  end,
+   vector<Graph::node_no_t>        const& pred)
+{
+   vector<Graph::node_no_t> path;
+
+   for(Graph::node_no_t n = end; n != start; n = pred[n])
+      path.push_back(n);
+
+   path.push_back(start);
+
+   std::reverse(path.begin(), path.end());
+
+   return path;
+}
+
+/** Labels of a point to point query. Outside a query every dist is infinite_dist and
+ *  every pred invalid_node. The query records which nodes it labeled and only these
+ *  are reset afterwards, so a query costs nothing for the nodes it does not reach.
+ */
+struct QueryLabels
+{
+   vector<double>           dist;
+   vector<Graph::node_no_t> pred;
+   vector<Graph::node_no_t> touched;
+
+   void label(Graph::node_no_t const node, double const node_dist, Graph::node_no_t const node_pred)
+   {
+      if (dist[node] == Graph::infinite_dist) //lint !e777
+         touched.push_back(node);
+
+      dist[node] = node_dist;
+      pred[node] = node_pred;
+   }
+};
+
+/** The two sets of labels of the calling thread, one for each side of a query.
+ *  They are kept from query to query, which saves allocating and filling arrays of
+ *  node_count() entries each time. The labels are reset when the workspace goes out
+ *  of scope, also if the query is left by an exception.
+ */
+class QueryWorkspace
+{
+private:
+   QueryLabels* labels_;
+
+public:
+   explicit QueryWorkspace(Graph::node_no_size_t const nodes)
+   {
+      static thread_local QueryLabels labels[2];
+
+      labels_ = labels;
+
+      for(int side = 0; side < 2; side++)
+      {
+         assert(labels_[side].touched.empty()); // no query running in this thread
+
+         if (labels_[side].dist.size() < nodes)
+         {
+            labels_[side].dist.resize(nodes, Graph::infinite_dist);
+            labels_[side].pred.resize(nodes, Graph::invalid_node);
+         }
+      }
+   }
+   ~QueryWorkspace()
+   {
+      for(int side = 0; side < 2; side++)
+      {
+         for(auto const node : labels_[side].touched)
+         {
+            labels_[side].dist[node] = Graph::infinite_dist;
+            labels_[side].pred[node] = Graph::invalid_node;
+         }
+         labels_[side].touched.clear();
+      }
+   }
+   QueryWorkspace(QueryWorkspace const&)            = delete;
+   QueryWorkspace& operator=(QueryWorkspace const&) = delete;
+
+   QueryLabels& operator[](int const side) { return labels_[side]; };
+};
+
+/** Shortest path from start to end with Dijkstras algorithm run from both sides.
+ *  The side with the smaller label in its queue is extended, every arc to a
+ *  node labeled by the other side gives a path. The search stops once the two
+ *  smallest labels in the queues add up to at least the shortest path found.
+ */
+Graph::ShortestPath Graph::bidirectional_dijkstra(node_no_t const start, node_no_t const end) const
+{
+   assert(start < node_count());
+   assert(end   < node_count());
+
+   if (start == end)
+      return { 0.0, { start } };
+
+   // Side 0 searches from start, side 1 from end
+   QueryWorkspace  labels(node_count());
+   BinaryHeapQueue queue[2];
+
+   labels[0].label(start, 0.0, invalid_node);
+   labels[1].label(end,   0.0, invalid_node);
+   queue[0].push(start, 0.0);
+   queue[1].push(end, 0.0);
+
+   double    best      = infinite_dist;
+   node_no_t best_tail = invalid_node; // best path: start ... best_tail - best_head ... end
+   node_no_t best_head = invalid_node;
+
+   while(not queue[0].empty() and not queue[1].empty())
+   {
+      if (queue[0].top().dist_ + queue[1].top().dist_ >= best)
+         break;
+
+      int const       side  = queue[0].top().dist_ <= queue[1].top().dist_ ? 0 : 1;
+      Entry     const entry = queue[side].pop();
+      node_no_t const tail  = entry.node_no_;
+
+      vector<double> const& dist       = labels[side].dist;
+      vector<double> const& other_dist = labels[1 - side].dist;
+
+      // Already done node? Ignore!
+      if (entry.dist_ > dist[tail])
+         continue;
+
+      for(auto neighbor : get_node(tail).adjacent_nodes())
+      {
+         node_no_t const head   = neighbor.node_no();
+         double    const weight = neighbor.dist() + dist[tail];
+
+         assert(neighbor.dist() >= 0);
+
+         if (dist[head] > weight)
+         {
+            labels[side].label(head, weight, tail);
+
+            queue[side].push(head, weight);
+         }
+         // Does this arc connect to the other side?
+         if (other_dist[head] < infinite_dist and weight + other_dist[head] < best)
+         {
+            best      = weight + other_dist[head];
+            best_tail = side == 0 ? tail : head;
+            best_head = side == 0 ? head : tail;
+         }
+      }
+   }
+   if (best_tail == invalid_node)
+      return { infinite_dist, {} };
+
+   vector<node_no_t> path = build_path(start, best_tail, labels[0].pred);
+
+   for(node_no_t n = best_head; n != invalid_node; n = labels[1].pred[n])
+      path.push_back(n);
+
+   return { best, path };
+}
+
+/** Entry into the A* queue, ordered by dist + heuristic.
+ */
+struct AStarEntry
+{
+   Graph::node_no_t node_no_;
+   double           dist_;
+   double           key_;
+
+   bool operator>(AStarEntry const& b) const { return key_ > b.key_; };
+};
+
+/** Shortest path from start to end with the A* algorithm.
+ *  Nodes are taken from the queue by dist + heuristic, where heuristic(n) must be
+ *  a lower bound for the distance from n to end. If it is also consistent,
+ *  i.e., heuristic(n) <= dist(n, m) + heuristic(m) for each edge nm, each node is
+ *  taken only once, otherwise nodes are taken again when their label improves.
+ *  With heuristic = 0 this is Dijkstras algorithm stopped at end.
+ */
+Graph::ShortestPath Graph::astar(node_no_t const start, node_no_t const end, Heuristic const& heuristic) const
+{
+   using std::priority_queue;
+   using std::greater;
+
+   assert(start < node_count());
+   assert(end   < node_count());
+
+   QueryWorkspace           labels(node_count());
+   vector<double>    const& dist = labels[0].dist;
+   vector<node_no_t> const& pred = labels[0].pred;
+
+   priority_queue<AStarEntry, vector<AStarEntry>, greater<AStarEntry>> queue;
+
+   labels[0].label(start, 0.0, invalid_node);
+   queue.push({ start, 0.0, heuristic(start) });
+
+   while(not queue.empty())
+   {
+      AStarEntry const entry = queue.top();
+      node_no_t  const tail  = entry.node_no_;
+
+      queue.pop();
+
+      // Already done node? Ignore!
+      if (entry.dist_ > dist[tail])
+         continue;
+
+      if (tail == end)
+         return { dist[end], build_path(start, end, pred) };
+
+      for(auto neighbor : get_node(tail).adjacent_nodes())
+      {
+         node_no_t const head   = neighbor.node_no();
+         double    const weight = neighbor.dist() + dist[tail];
+
+         assert(neighbor.dist() >= 0);
+
+         if (dist[head] > weight)
+         {
+            labels[0].label(head, weight, tail);
+
+            queue.push({ head, weight, weight + heuristic(head) });
+         }
+      }
+   }
+   return { infinite_dist, {} };
+}
+
+/** Heuristic for astar(): the distance to end in the plane, multiplied by the
+ *  factor from set_coordinates(), such that it is a lower bound. It is also consistent.
+ *  It refers to the coordinates of the graph, which must not change while it is used.
  */
+Graph::Heuristic Graph::euclidean_heuristic(node_no_t const end) const
+{
+   if (not has_coordinates())
+      throw std::runtime_error("No coordinates for the euclidean heuristic");
+
+   assert(end < node_count());
+
+   double const         x     = coordinates_[2 * size_t(end)];
+   double const         y     = coordinates_[2 * size_t(end) + 1];
+   double const         scale = coordinate_scale_;
+   double const* const  xy    = coordinates_.data();
+
+   return [=](node_no_t const n) { return scale * std::hypot(xy[2 * size_t(n)] - x, xy[2 * size_t(n) + 1] - y); };
+}
@@ -0,0 +1,225 @@
+/**
+ \file      dijkstra_bench.cpp
+ \brief     Benchmark for the priority queues of Graph::dijkstra()
+ \author    Thorsten Koch
+ \version   1.0
+ \date      01Dec2022
+ \details
+
+ Runs Dijkstra from the same random start nodes with each queue and checks
+ that all queues give the same distances. Then the point to point queries from
+ these nodes to random end nodes are timed against the full Dijkstra runs.
+ The graph is either read from a .gph or .gphb file or generated as a grid with
+ random integral edge lengths, which is similar to a road network.
+*/
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <exception>
+
+#include "graph.hpp"
+
+using namespace std;
+
+/** side x side grid, each node is connected to its right and lower neighbor.
+ */
+Graph grid_graph(Graph::node_no_t const side, unsigned const max_length, unsigned const seed)
+{
+   mt19937                           generator(seed);
+   uniform_int_distribution<unsigned> length(1, max_length);
+
+   Graph g(side * side);
+
+   for(Graph::node_no_t r = 0; r < side; r++)
+   {
+      for(Graph::node_no_t c = 0; c < side; c++)
+      {
+         Graph::node_no_t const n = r * side + c;
+
+         if (c + 1 < side)
+            g.add_edge(n, n + 1, length(generator));
+
+         if (r + 1 < side)
+            g.add_edge(n, n + side, length(generator));
+      }
+   }
+   g.finalize();
+   g.info();
+
+   // All lengths are at least 1, so with unit spacing the euclidean distance is a lower bound
+   vector<double> xy(2 * size_t(side) * side);
+
+   for(Graph::node_no_t n = 0; n < side * side; n++)
+   {
+      xy[2 * size_t(n)]     = n % side;
+      xy[2 * size_t(n) + 1] = n / side;
+   }
+   g.set_coordinates(move(xy));
+
+   return g;
+}
+
+/** ./dijkstra_bench [-f file.gph|file.gphb] [-g side] [-l max_length] [-q queries] [-s seed]
+ *    file        Graph to use, .gphb is mapped with map_binary().
+ *    side        Otherwise a side x side grid is generated, default 1000.
+ *    max_length  Edge lengths of the grid are from 1 to max_length, default 1000.
+ *    queries     Number of start nodes, default 10.
+ */
+int main(int argc, char const* const* const argv)
+{
+   using std::chrono::high_resolution_clock;
+   using std::chrono::duration;
+
+   try
+   {
+      string   filename;
+      unsigned side       = 1000;
+      unsigned max_length = 1000;
+      unsigned queries    = 10;
+      unsigned seed       = 20221201;
+
+      for(int i = 1; i < argc; i += 2)
+      {
+         string const option = argv[i];
+
+         if (i + 1 >= argc)
+            throw runtime_error("Missing value for option " + option);
+
+         string const value = argv[i + 1];
+
+         if (option == "-f")
+            filename = value;
+         else if (option == "-g")
+            side = static_cast<unsigned>(stoul(value));
+         else if (option == "-l")
+            max_length = static_cast<unsigned>(stoul(value));
+         else if (option == "-q")
+            queries = static_cast<unsigned>(stoul(value));
+         else if (option == "-s")
+            seed = static_cast<unsigned>(stoul(value));
+         else
+            throw runtime_error("Unknown option " + option);
+      }
+      if (side < 1 or max_length < 1 or queries < 1 or side > 60000)
+      {
+         cerr << "usage: " << argv[0] << " [-f file.gph|file.gphb] [-g side] [-l max_length] [-q queries] [-s seed]\n";
+         return -1;
+      }
+      Graph g;
+
+      if (filename.empty())
+         g = grid_graph(side, max_length, seed);
+      else if (filename.size() > 5 and filename.compare(filename.size() - 5, 5, ".gphb") == 0)
+         g.map_binary(filename);
+      else
+         g.read(filename);
+
+      mt19937                                    generator(seed);
+      uniform_int_distribution<Graph::node_no_t> node(0, g.node_count() - 1);
+      vector<Graph::node_no_t>                   starts(queries);
+
+      for(auto& s : starts)
+         s = node(generator);
+
+      struct Engine
+      {
+         char const*   name;
+         DijkstraQueue queue;
+      };
+      Engine const engines[] =
+      {
+         { "binary_heap", DijkstraQueue::binary_heap },
+         { "radix_heap",  DijkstraQueue::radix_heap  },
+         { "dial",        DijkstraQueue::dial        },
+         { "dary_heap",   DijkstraQueue::dary_heap   }
+      };
+      vector<vector<double>>   reference;
+      vector<double>           dist(g.node_count());
+      vector<Graph::node_no_t> pred(g.node_count());
+      double                   reference_ms = 0.0;
+
+      cout << "queue           queries    total[ms]    per query[ms]  speedup\n";
+
+      for(auto const& engine : engines)
+      {
+         double total_ms   = 0.0;
+         bool   same_dists = true;
+
+         try
+         {
+            for(size_t q = 0; q < starts.size(); q++)
+            {
+               auto const start_time_ms = high_resolution_clock::now();
+
+               g.dijkstra(starts[q], dist, pred, true, engine.queue);
+
+               duration<double, milli> const duration_ms = high_resolution_clock::now() - start_time_ms;
+
+               total_ms += duration_ms.count();
+
+               if (reference.size() < starts.size())
+                  reference.push_back(dist);
+               else
+               {
+                  for(size_t n = 0; n < dist.size(); n++)
+                     if (abs(dist[n] - reference[q][n]) > 1e-9 * max(1.0, abs(reference[q][n])))
+                        same_dists = false;
+               }
+            }
+         }
+         catch(exception const& e)
+         {
+            cout << left << setw(15) << engine.name << " skipped: " << e.what() << endl;
+            continue;
+         }
+         if (reference_ms == 0.0)
+            reference_ms = total_ms;
+
+         cout << left << setw(15) << engine.name << right << setw(8) << queries
+              << fixed << setprecision(2) << setw(13) << total_ms << setw(17) << total_ms / queries
+              << setw(9) << reference_ms / total_ms << (same_dists ? "" : "  DISTANCES DIFFER") << endl;
+
+         if (not same_dists)
+            throw runtime_error(string("Wrong distances with ") + engine.name);
+      }
+      // Point to point queries
+      vector<Graph::node_no_t> ends(queries);
+
+      for(auto& e : ends)
+         e = node(generator);
+
+      auto point_to_point = [&](char const* const name, auto const& query)
+      {
+         double total_ms = 0.0;
+
+         for(size_t q = 0; q < starts.size(); q++)
+         {
+            auto const start_time_ms = high_resolution_clock::now();
+
+            double const sp = query(starts[q], ends[q]);
+
+            duration<double, milli> const duration_ms = high_resolution_clock::now() - start_time_ms;
+
+            total_ms += duration_ms.count();
+
+            if (abs(sp - reference[q][ends[q]]) > 1e-9 * max(1.0, abs(reference[q][ends[q]])))
+               throw runtime_error(string("Wrong distance with ") + name);
+         }
+         cout << left << setw(15) << name << right << setw(8) << queries
+              << fixed << setprecision(2) << setw(13) << total_ms << setw(17) << total_ms / queries
+              << setw(9) << reference_ms / total_ms << endl;
+      };
+      point_to_point("bidirectional", [&](Graph::node_no_t s, Graph::node_no_t e) { return g.bidirectional_dijkstra(s, e).dist; });
+      point_to_point("astar_zero",    [&](Graph::node_no_t s, Graph::node_no_t e) { return g.astar(s, e, [](Graph::node_no_t) { return 0.0; }).dist; });
+
+      if (g.has_coordinates())
+         point_to_point("astar_euclid", [&](Graph::node_no_t s, Graph::node_no_t e) { return g.astar(s, e, g.euclidean_heuristic(e)).dist; });
+   }
+   catch(exception const& e)
+   {
+      cerr << "Exception: " << e.what() << endl;
+      return -1;
+   }
+}
@@ -11,14 +11,22 @@
 
 #include <iostream>
 #include <stack>
-#include <fstream>
-#include <sstream>
 #include <algorithm>
 #include <iterator>
+#include <numeric>
+#include <atomic>
+#include <thread>
+#include <charconv>
+#include <cstring>
+#include <cctype>
+#include <type_traits>
+#include <cmath>
 
 #include "graph.hpp"
+#include "mapped_file.hpp"
 
 using std::vector;
+using std::string;
 
 /** Print the graph info.
  */
@@ -29,47 +37,147 @@ void Graph::info(bool const show_all) const
    cout << "Graph with " << node_count() << " vertices";
 
    if (show_all)
-      cout << "\n";
-   
-   size_t edge_count = 0;
-   
-   for (node_no_t node_no = 0; node_no < node_count(); ++node_no) 
    {
-      if (show_all)
-         cout << "Incident edges to vertex " << node_no << ":\n";
+      cout << "\n";
 
-      for(auto neighbor: get_node(node_no).adjacent_nodes())
+      for (node_no_t node_no = 0; node_no < node_count(); ++node_no) 
       {
-         if (show_all)
-            cout << node_no << " - " << neighbor.node_no() << " dist= " << neighbor.dist() << "\n";
+         cout << "Incident edges to vertex " << node_no << ":\n";
 
-         edge_count++;
+         for(auto neighbor: get_node(node_no).adjacent_nodes())
+            cout << node_no << " - " << neighbor.node_no() << " dist= " << neighbor.dist() << "\n";
       }
    }
+   // Each edge is stored as two arcs
+   arc_no_t const edge_count = arc_count();
+
    assert(edge_count % 2 == 0);
 
    cout << " and " << edge_count / 2 << " edges.\n";
 }
 
+namespace
+{
+   // Same as isspace() in the C locale, which is what operator>> skips
+   inline bool is_blank(char c) { return c == ' ' or c == '\t' or c == '\r' or c == '\v' or c == '\f' or c == '\n'; };
+
+   inline char const* skip_blanks(char const* p, char const* end)
+   {
+      while(p < end and is_blank(*p))
+         p++;
+
+      return p;
+   }
+
+   /** Parse a number at p, advancing p. Same as operator>>, leading blanks and a + sign are allowed.
+    */
+   template <typename T>
+   bool parse_number(char const*& p, char const* end, T& val)
+   {
+      p = skip_blanks(p, end);
+
+      if (p < end and *p == '+' and p + 1 < end and *(p + 1) != '-')
+         p++;
+
+      // operator>> does not accept inf and nan, so neither do we
+      if constexpr (std::is_floating_point_v<T>)
+         if (char const* q = p < end and *p == '-' ? p + 1 : p; q < end and std::isalpha(static_cast<unsigned char>(*q)))
+            return false;
+
+      auto const [next, ec] = std::from_chars(p, end, val);
+
+      p = next;
+
+      return ec == std::errc();
+   }
+
+   /** Next line [p, eol), returns the start of the following line.
+    */
+   inline char const* next_line(char const* p, char const* end, char const*& eol)
+   {
+      eol = static_cast<char const*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+
+      if (eol == nullptr)
+      {
+         eol = end;
+         return end;
+      }
+      return eol + 1;
+   }
+}
+
+/** The edge lines [begin, end) of a .gph file, parsed independently of the others.
+ */
+struct Graph::ReadChunk
+{
+   enum class Error { none, syntax, node_no, loop, dist };
+
+   char const*         begin;
+   char const*         end;
+   size_t              lines      = 0;           //< Number of lines in the chunk
+   size_t              error_line = 0;           //< Line within the chunk of the first error
+   Error               error      = Error::none;
+   std::string         error_text;               //< The line with the error
+   vector<PendingEdge> edges;
+
+   void parse(long long nodes);
+};
+
+/** Parse all lines up to the first error. Whether there are too many edges is
+ *  only known once the edges in the preceding chunks are counted.
+ */
+void Graph::ReadChunk::parse(long long const nodes)
+{
+   edges.reserve(static_cast<size_t>(end - begin) / 8);
+
+   for(char const* p = begin; p < end; lines++)
+   {
+      char const*       eol;
+      char const* const next = next_line(p, end, eol);
+      char const*       q    = p;
+      long long         tail;
+      long long         head;
+      double            dist;
+
+      if (not parse_number(q, eol, tail) or not parse_number(q, eol, head))
+         error = Error::syntax;
+      else if (tail < 1 || tail > nodes || head < 1 || head > nodes) 
+         error = Error::node_no;
+      else if (tail == head) 
+         error = Error::loop;
+      else if (not parse_number(q, eol, dist))
+         error = Error::dist;
+
+      if (error != Error::none)
+      {
+         error_line = lines + 1;
+         error_text.assign(p, eol);
+         return;
+      }
+      // Node numbers in the file start with 1, internally with 0
+      edges.push_back({ static_cast<node_no_t>(tail - 1), static_cast<node_no_t>(head - 1), dist });
+
+      p = next;
+   }
+}
+
 /** Read a Graph froma file.
+ *  The file is mapped into memory. The edge lines are split into chunks,
+ *  which are parsed in parallel. The edges of the chunks are then sorted serially into
+ *  the adjacency arrays in file order, without collecting them in one list first.
+ *  The line numbers in the error messages are the same as for a sequential read.
+ *  \param threads Number of threads used for parsing, 0 means all hardware threads.
  */
-void Graph::read(std::string const& filename)
+void Graph::read(std::string const& filename, unsigned threads)
 {
-   using std::ifstream;
-   using std::string;
-   using std::getline;
    using std::to_string;
-   using std::istringstream;
    using std::runtime_error;
    using std::cout;
    using std::endl;
    
-   constexpr auto max_size = std::numeric_limits<std::streamsize>::max();
-   
-   ifstream file(filename); 
-   
-   if (not file) 
-      throw runtime_error("Cannot open file: " + filename);
+   MappedFile const  file(filename);
+   char const*       p   = file.data();
+   char const* const end = file.data() + file.size();
 
    cout << "Reading " << filename << endl;
    
@@ -78,72 +186,336 @@ void Graph::read(std::string const& filename)
    long long count   = 0;
    size_t    line_no = 1;
    
-   if ((file >> nodes >> edges).fail() or nodes < 1 or edges < 0)
+   // Like operator>>, the counts may be preceded by empty lines 
+   if (not parse_number(p, end, nodes) or not parse_number(p, end, edges) or nodes < 1 or edges < 0)
       throw runtime_error("Line:" + to_string(line_no) + " node or edge count missing or illegal");
 
    if (nodes >= std::numeric_limits<node_no_size_t>::max())
       throw runtime_error("Line:" + to_string(line_no) + " node count too big for node_no_size_t");
       
-   nodes_.resize(nodes); //lint !e732
+   *this = Graph(static_cast<node_no_size_t>(nodes));
 
-   file.ignore(max_size, '\n'); // skip the rest of the line 
-   
-   for(string line; getline(file, line); ++line_no) //lint !e440 !e443
+   char const* eol;
+
+   p = next_line(p, end, eol); // skip the rest of the line 
+
+   // Split at line boundaries into chunks of at least 1MB
+   size_t const min_chunk = 1 << 20;
+
+   if (threads == 0)
+      threads = std::max(1u, std::thread::hardware_concurrency());
+
+   size_t const chunk_count = std::clamp(static_cast<size_t>(end - p) / min_chunk, size_t(1), size_t(4) * threads);
+   size_t const chunk_size  = static_cast<size_t>(end - p) / chunk_count + 1;
+
+   vector<ReadChunk> chunks;
+
+   while(p < end)
    {
-      istringstream iss(line);
-      long long head;
-      long long tail;
-      
-      if ((iss >> tail >> head).fail())
-         throw runtime_error("Line " + to_string(line_no) + " syntax error: " + line);
+      char const* split = p + std::min(chunk_size, static_cast<size_t>(end - p));
 
-      if (tail < 1 || tail > nodes || head < 1 || head > nodes) 
-         throw runtime_error("Line " + to_string(line_no) + " node number outside 1.." + to_string(nodes));
+      if (split < end)
+         split = next_line(split, end, eol);
 
-      if (tail == head) 
-         throw runtime_error("Line " + to_string(line_no) + " loops not allowed");
+      chunks.push_back({ p, split, 0, 0, ReadChunk::Error::none, {}, {} });
+      p = split;
+   }
+   threads = std::min(threads, static_cast<unsigned>(chunks.size()));
 
-      if (count >= edges)
-         throw runtime_error("Line " + to_string(line_no) + " too many edges");
+   if (threads <= 1)
+   {
+      for(auto& chunk : chunks)
+         chunk.parse(nodes);
+   }
+   else
+   {
+      std::atomic<size_t> next_chunk(0);
+      vector<std::thread> workers;
 
-      double dist;
-      if ((iss >> dist).fail())
-         throw runtime_error("Line " + to_string(line_no) + " syntax error: " + line);
+      for(unsigned t = 0; t < threads; t++)
+         workers.emplace_back([&] 
+         {
+            for(size_t c = next_chunk++; c < chunks.size(); c = next_chunk++)
+               chunks[c].parse(nodes);
+         });
 
-      // Check what happens if -7
+      for(auto& worker : workers)
+         worker.join();
+   }
 
-      // Node numbers in the file start with 1, internally with 0
-      tail--;
-      head--;
-      
-      nodes_[tail].add_neighbor(static_cast<node_no_t>(head), dist); //lint !e732
-      nodes_[head].add_neighbor(static_cast<node_no_t>(tail), dist); //lint !e732
+   // Check in file order, such that the first error is reported
+   for(auto const& chunk : chunks)
+   {
+      auto const chunk_edges = static_cast<long long>(chunk.edges.size());
 
-      count++;
+      // Each line before the first error is an edge
+      if (count + chunk_edges > edges)
+         throw runtime_error("Line " + to_string(line_no + static_cast<size_t>(edges - count)) + " too many edges");
+
+      if (chunk.error != ReadChunk::Error::none)
+      {
+         string const line = "Line " + to_string(line_no + chunk.error_line - 1);
+
+         // Too many edges is checked before the distance is read
+         if (chunk.error == ReadChunk::Error::dist and count + chunk_edges >= edges)
+            throw runtime_error(line + " too many edges");
+
+         if (chunk.error == ReadChunk::Error::node_no)
+            throw runtime_error(line + " node number outside 1.." + to_string(nodes));
+
+         if (chunk.error == ReadChunk::Error::loop)
+            throw runtime_error(line + " loops not allowed");
+
+         throw runtime_error(line + " syntax error: " + chunk.error_text);
+      }
+      count   += chunk_edges;
+      line_no += chunk.lines;
    }
    if (edges != count)
       throw runtime_error("Line " + to_string(line_no) + " unexpected EOF: "
          + to_string(edges) + " edges expected, got " + to_string(count));
 
+   // The graph is empty, so this is the counting sort of finalize(), but reading the
+   // edges from the chunks instead of collecting them in new_edges_ first
+   auto adjacency = std::make_shared<Adjacency>();
+
+   vector<arc_no_t>&  offsets = adjacency->offsets;
+   vector<node_no_t>& heads   = adjacency->heads;
+   vector<double>&    dists   = adjacency->dists;
+
+   offsets.assign(static_cast<size_t>(nodes) + 1, 0);
+
+   for(auto const& chunk : chunks)
+      for(auto const& edge : chunk.edges)
+      {
+         offsets[edge.tail + 1]++;
+         offsets[edge.head + 1]++;
+      }
+   std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+   heads.resize(offsets.back());
+   dists.resize(offsets.back());
+
+   vector<arc_no_t> next(offsets.begin(), offsets.end() - 1);
+
+   for(auto& chunk : chunks)
+   {
+      for(auto const& edge : chunk.edges)
+      {
+         heads[next[edge.tail]]   = edge.head;
+         dists[next[edge.tail]++] = edge.dist;
+         heads[next[edge.head]]   = edge.tail;
+         dists[next[edge.head]++] = edge.dist;
+      }
+      vector<PendingEdge>().swap(chunk.edges);
+   }
+   set_adjacency(std::move(adjacency));
+
    if (has_parallel_arcs())
       throw runtime_error("Error: Graph has parallel edges");      
 
    info();
 }
 
+/** Read the coordinates of the nodes from a file, e.g. for euclidean_heuristic().
+ *  The first line has the number of nodes, which must be the same as for the graph,
+ *  then there is one line "node x y" for each node.
+ */
+void Graph::read_coordinates(std::string const& filename)
+{
+   using std::to_string;
+   using std::runtime_error;
+
+   MappedFile const  file(filename);
+   char const*       p   = file.data();
+   char const* const end = file.data() + file.size();
+
+   std::cout << "Reading " << filename << std::endl;
+
+   long long nodes;
+   size_t    line_no = 1;
+
+   if (not parse_number(p, end, nodes) or nodes != node_count())
+      throw runtime_error("Line:" + to_string(line_no) + " node count missing or not " + to_string(node_count()));
+
+   char const* eol;
+
+   p = next_line(p, end, eol); // skip the rest of the line 
+
+   vector<double> xy(2 * static_cast<size_t>(nodes));
+   vector<bool>   seen(static_cast<size_t>(nodes), false);
+   long long      count = 0;
+
+   for(; p < end; line_no++)
+   {
+      char const* const next = next_line(p, end, eol);
+      char const* const line = p;
+      long long         node;
+      double            x;
+      double            y;
+
+      if (not parse_number(p, eol, node) or not parse_number(p, eol, x) or not parse_number(p, eol, y))
+         throw runtime_error("Line " + to_string(line_no) + " syntax error: " + string(line, eol));
+
+      if (node < 1 or node > nodes) 
+         throw runtime_error("Line " + to_string(line_no) + " node number outside 1.." + to_string(nodes));
+
+      // Node numbers in the file start with 1, internally with 0
+      auto const n = static_cast<size_t>(node - 1);
+
+      if (seen[n])
+         throw runtime_error("Line " + to_string(line_no) + " coordinates of node " + to_string(node) + " given twice");
+
+      seen[n]       = true;
+      xy[2 * n]     = x;
+      xy[2 * n + 1] = y;
+      count++;
+      p             = next;
+   }
+   if (count != nodes)
+      throw runtime_error("Line " + to_string(line_no) + " unexpected EOF: "
+         + to_string(nodes) + " coordinates expected, got " + to_string(count));
+
+   set_coordinates(std::move(xy));
+}
+
+/** Set the coordinates, x and y of node n are xy[2n] and xy[2n + 1].
+ *  The largest factor by which no edge is shorter than the distance of its nodes
+ *  is determined, such that euclidean_heuristic() is a lower bound for any lengths.
+ */
+void Graph::set_coordinates(vector<double> xy)
+{
+   assert(xy.size() == 2 * size_t(node_count()) and new_edges_.empty());
+
+   double scale = infinite_dist;
+
+   for(node_no_t tail = 0; tail < node_count(); tail++)
+   {
+      for(auto neighbor : get_node(tail).adjacent_nodes())
+      {
+         node_no_t const head     = neighbor.node_no();
+         double    const distance = std::hypot(xy[2 * tail] - xy[2 * head], xy[2 * tail + 1] - xy[2 * head + 1]);
+
+         if (distance > 0.0)
+            scale = std::min(scale, neighbor.dist() / distance);
+      }
+   }
+   // Without any edge between different points, the coordinates tell nothing
+   if (scale == infinite_dist) //lint !e777
+      scale = 0.0;
+
+   // Keep a safety margin for the rounding errors in the distances 
+   coordinate_scale_ = scale * (1.0 - 1e-12);
+   coordinates_      = std::move(xy);
+}
+
+/** Graph with nodes nodes and no edges.
+ */
+Graph::Graph(node_no_size_t const nodes)
+{
+   auto adjacency = std::make_shared<Adjacency>();
+
+   adjacency->offsets.resize(nodes + size_t(1), 0);
+
+   set_adjacency(std::move(adjacency));
+}
+
+/** Use the arrays of adjacency from now on.
+ */
+void Graph::set_adjacency(std::shared_ptr<Adjacency const> adjacency)
+{
+   assert(not adjacency->offsets.empty());
+
+   node_count_ = static_cast<node_no_size_t>(adjacency->offsets.size() - 1);
+   offsets_    = adjacency->offsets.data();
+   heads_      = adjacency->heads.data();
+   dists_      = adjacency->dists.data();
+   storage_    = std::move(adjacency);
+}
+
+/** Add an undirected edge. It becomes visible in the adjacency after finalize().
+ */
+void Graph::add_edge(node_no_t const tail, node_no_t const head, double const dist)
+{
+   assert(tail < node_count() and head < node_count());
+
+   new_edges_.push_back({ tail, head, dist });
+}
+
+/** Build the compressed sparse row adjacency from the added edges.
+ *  This is a counting sort by tail, which keeps the arcs of each node
+ *  in the order the edges were added.
+ */
+void Graph::finalize()
+{
+   if (new_edges_.empty())
+      return;
+
+   node_no_size_t const nodes = node_count();
+   vector<arc_no_t>     offsets(nodes + size_t(1), 0);
+
+   // Count the arcs of each node, the ones already there and the new ones
+   for(node_no_t n = 0; n < nodes; n++)
+      offsets[n + 1] = offsets_[n + 1] - offsets_[n];
+
+   for(auto const& edge : new_edges_)
+   {
+      offsets[edge.tail + 1]++;
+      offsets[edge.head + 1]++;
+   }
+   std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+   auto adjacency = std::make_shared<Adjacency>();
+
+   adjacency->heads.resize(offsets[nodes]);
+   adjacency->dists.resize(offsets[nodes]);
+
+   vector<node_no_t>& heads = adjacency->heads;
+   vector<double>&    dists = adjacency->dists;
+   vector<arc_no_t>   next(nodes);
+
+   // The arcs already there stay in front
+   for(node_no_t n = 0; n < nodes; n++)
+   {
+      next[n] = offsets[n];
+
+      for(arc_no_t a = offsets_[n]; a < offsets_[n + 1]; a++, next[n]++)
+      {
+         heads[next[n]] = heads_[a];
+         dists[next[n]] = dists_[a];
+      }
+   }
+   for(auto const& edge : new_edges_)
+   {
+      heads[next[edge.tail]]   = edge.head;
+      dists[next[edge.tail]++] = edge.dist;
+      heads[next[edge.head]]   = edge.tail;
+      dists[next[edge.head]++] = edge.dist;
+   }
+   adjacency->offsets.swap(offsets);
+   set_adjacency(std::move(adjacency));
+
+   new_edges_.clear();
+   new_edges_.shrink_to_fit();
+}
+
 /** Check whether the graph has parallel edges.
+ *  last_tail[v] is the last node with an arc to v, so a second arc
+ *  from the same node is found in linear time.
  */
 bool Graph::has_parallel_arcs() const
 {
-   for(auto node : nodes_)
-   {
-      vector<Neighbor> neighbors(node.adjacent_nodes());
+   vector<node_no_t> last_tail(node_count(), invalid_node);
 
-      std::sort(neighbors.begin(), neighbors.end(), 
-         [](Neighbor const& a, Neighbor const& b) -> bool { return a.node_no() > b.node_no(); });
+   for(node_no_t node_no = 0; node_no < node_count(); ++node_no) 
+   {
+      for(auto neighbor : get_node(node_no).adjacent_nodes())
+      {
+         if (last_tail[neighbor.node_no()] == node_no)
+            return true;
 
-      if (std::adjacent_find(neighbors.begin(), neighbors.end()) != neighbors.end())
-         return true;
+         last_tail[neighbor.node_no()] = node_no;
+      }
    }
    return false;
 }
@@ -13,13 +13,29 @@
 
 #include <vector>
 #include <string>
+#include <memory>
+#include <functional>
 #include <limits>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <cassert>
 
+/** Priority queues for Graph::dijkstra().
+ */
+enum class DijkstraQueue
+{
+   binary_heap, //< std::priority_queue, a node is inserted again for each shorter label
+   radix_heap,  //< Radix heap on the bits of the labels, works for all non-negative lengths
+   dial,        //< Dial's buckets, only for integral edge lengths, one bucket per possible label
+   dary_heap    //< Indexed 4-ary heap with decrease-key
+};
+
 class Graph {
 public:
    using node_no_t      = unsigned int;  // vertices are numbered 0, ... ,node_count() - 1
    using node_no_size_t = node_no_t;
+   using arc_no_t       = std::size_t;   // each edge is stored as two arcs, one in each direction
    
    class Neighbor
    {
@@ -35,18 +51,110 @@ public:
       bool      operator==(Neighbor const& b) const { return node_no_ == b.node_no_; };
    };
 
+   /** Iterates over the arcs of a node, dereferencing gives the Neighbor by value.
+    */
+   class NeighborIterator
+   {
+   private:
+      node_no_t const* head_;
+      double    const* dist_;
+
+   public:
+      // An input iterator only, since dereferencing returns a Neighbor by value
+      using iterator_category = std::input_iterator_tag;
+      using value_type        = Neighbor;
+      using difference_type   = std::ptrdiff_t;
+      using reference         = Neighbor;
+
+      /** Result of operator->, holds the Neighbor, since there is none in memory to point to.
+       */
+      class pointer
+      {
+      private:
+         Neighbor neighbor_;
+
+      public:
+         explicit pointer(Neighbor neighbor) : neighbor_(neighbor) {}
+
+         Neighbor const* operator->() const { return &neighbor_; };
+      };
+
+      NeighborIterator() : head_(nullptr), dist_(nullptr) {}
+      NeighborIterator(node_no_t const* head, double const* dist) : head_(head), dist_(dist) {}
+
+      Neighbor          operator*()                           const { return Neighbor(*head_, *dist_); };
+      pointer           operator->()                          const { return pointer(**this); };
+      NeighborIterator& operator++()                                { ++head_; ++dist_; return *this; };
+      NeighborIterator  operator++(int)                             { NeighborIterator const old = *this; ++*this; return old; };
+      bool              operator==(NeighborIterator const& b) const { return head_ == b.head_; };
+      bool              operator!=(NeighborIterator const& b) const { return head_ != b.head_; };
+   };
+
+   /** View of the consecutive arcs of one node in the adjacency arrays.
+    */
    class Node
    {
    private:
-      std::vector<Neighbor> neighbors_;
+      node_no_t const* heads_;
+      double    const* dists_;
+      arc_no_t         degree_;
 
    public:
-      void add_neighbor(node_no_t node_no, double dist)    { neighbors_.emplace_back(Neighbor(node_no, dist)); }; //lint !e534
-      std::vector<Neighbor> const& adjacent_nodes() const  { return neighbors_; };
+      Node(node_no_t const* heads, double const* dists, arc_no_t degree) : heads_(heads), dists_(dists), degree_(degree) {}
+
+      arc_no_t         degree()         const { return degree_; };
+      Node             adjacent_nodes() const { return *this; };
+      NeighborIterator begin()          const { return NeighborIterator(heads_, dists_); };
+      NeighborIterator end()            const { return NeighborIterator(heads_ + degree_, dists_ + degree_); };
    };
+
+   /** Result of a point to point query.
+    */
+   struct ShortestPath
+   {
+      double                 dist; //< infinite_dist if end cannot be reached from start
+      std::vector<node_no_t> path; //< start, ..., end, empty if end cannot be reached
+   };
+
+   /** Lower bound for the distance of a node to the target of an A* query.
+    */
+   using Heuristic = std::function<double(node_no_t)>;
    
 private:
-   std::vector<Node> nodes_;
+   struct PendingEdge
+   {
+      node_no_t tail;
+      node_no_t head;
+      double    dist;
+   };
+
+   /** Adjacency arrays built by finalize().
+    */
+   struct Adjacency
+   {
+      std::vector<arc_no_t>  offsets;
+      std::vector<node_no_t> heads;
+      std::vector<double>    dists;
+   };
+
+   /* Compressed sparse row adjacency: the arcs leaving node n are
+    * heads_[offsets_[n]] ... heads_[offsets_[n + 1] - 1] with lengths in dists_.
+    * The arrays belong to storage_, which is either an Adjacency or a mapped
+    * binary file. They are never changed, so copies of a graph share them.
+    */
+   std::shared_ptr<void const> storage_;
+   node_no_size_t              node_count_ = 0;
+   arc_no_t const*             offsets_    = nullptr;
+   node_no_t const*            heads_      = nullptr;
+   double const*               dists_      = nullptr;
+   std::vector<PendingEdge>    new_edges_; //< Added, but not yet in the adjacency arrays
+   std::vector<double>         coordinates_;            //< x and y of node n are at 2n and 2n + 1, empty if unknown
+   double                      coordinate_scale_ = 0.0; //< No edge is shorter than this times the distance of its nodes
+
+   struct ReadChunk;
+
+   void set_adjacency(std::shared_ptr<Adjacency const> adjacency);
+   std::uint64_t max_integral_length() const;
 
    bool has_parallel_arcs() const;
    bool path_is_a_tree(node_no_t root, std::vector<node_no_t> const& pred, bool check_is_spanning = true) const;
@@ -55,19 +163,37 @@ private:
    
 public:
    Graph()                        = default;
+   explicit Graph(node_no_size_t nodes);
    Graph(const Graph&)            = default; 
    Graph(Graph&&)                 = default; 
-   // Graph& operator=(const Graph&) = default;
-   // Graph& operator=(Graph&&)      = default;
+   Graph& operator=(const Graph&) = default;
+   Graph& operator=(Graph&&)      = default;
    ~Graph()                       = default;   
 
-   void           read(std::string const& filename);
+   void           read(std::string const& filename, unsigned threads = 0);
+   void           add_edge(node_no_t tail, node_no_t head, double dist);
+   void           finalize();
+   void           save_binary(std::string const& filename) const;
+   void           map_binary(std::string const& filename, bool verify = true);
+   void           read_coordinates(std::string const& filename);
+   void           set_coordinates(std::vector<double> xy);
+   bool           has_coordinates() const { return not coordinates_.empty(); };
 
-   node_no_size_t node_count()             const { return static_cast<node_no_size_t>(nodes_.size()); }; 
-   Node const&    get_node(node_no_t node) const { return nodes_[node]; };
+   node_no_size_t node_count()             const { return node_count_; }; 
+   arc_no_t       arc_count()              const { return offsets_ == nullptr ? 0 : offsets_[node_count_]; };
+   Node           get_node(node_no_t node) const
+   {
+      assert(node < node_count() and new_edges_.empty());
+
+      return Node(heads_ + offsets_[node], dists_ + offsets_[node], offsets_[node + 1] - offsets_[node]);
+   };
    void           info(bool show_all = false) const;
    node_no_size_t bfs(node_no_t start, std::vector<node_no_size_t>& depth, std::vector<node_no_t>& pred) const;
-   void           dijkstra(node_no_t start, std::vector<double>& dist, std::vector<node_no_t>& pred, bool initialize = true) const;
+   void           dijkstra(node_no_t start, std::vector<double>& dist, std::vector<node_no_t>& pred, bool initialize = true,
+                     DijkstraQueue queue = DijkstraQueue::binary_heap) const;
+   ShortestPath   bidirectional_dijkstra(node_no_t start, node_no_t end) const;
+   ShortestPath   astar(node_no_t start, node_no_t end, Heuristic const& heuristic) const;
+   Heuristic      euclidean_heuristic(node_no_t end) const;
    double         kruskal(node_no_size_t& num_components) const;
    node_no_size_t component_count() const;
 
@@ -0,0 +1,195 @@
+/**
+ \file      graph_binary.cpp
+ \brief     Binary snapshot of a Graph, mapped back without parsing or copying
+ \author    Thorsten Koch
+ \version   1.0
+ \date      01Dec2022
+ \details
+
+ The file starts with a GraphFileHeader of 64 bytes, followed by the three adjacency
+ arrays offsets, heads and dists exactly as they are in memory, each starting at an
+ 8 byte boundary. map_binary() maps the file read-only and the graph uses the arrays
+ in place, so loading takes constant time apart from the optional checksum test, and
+ all processes mapping the same file share the pages in the page cache.
+ The file is only meant to be read on the machine type it was written on.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <exception>
+
+#include "graph.hpp"
+#include "mapped_file.hpp"
+
+namespace
+{
+   struct GraphFileHeader
+   {
+      static constexpr char          magic_id[8]     = { 'G', 'R', 'A', 'P', 'H', 'B', 'I', 'N' };
+      static constexpr std::uint32_t current_version = 1;
+
+      char          magic[8];
+      std::uint32_t version;
+      std::uint16_t node_no_size;   //< sizeof(Graph::node_no_t)
+      std::uint16_t arc_no_size;    //< sizeof(Graph::arc_no_t)
+      std::uint64_t node_count;
+      std::uint64_t arc_count;      //< Twice the number of edges
+      std::uint64_t heads_offset;   //< Start of heads from the beginning of the file, offsets start after the header
+      std::uint64_t dists_offset;   //< Start of dists from the beginning of the file
+      std::uint64_t checksum;       //< graph_file_checksum() of everything after the header
+      char          reserved[8];
+   };
+
+   static_assert(sizeof(GraphFileHeader) == 64);
+
+   constexpr std::uint64_t round_up8(std::uint64_t const x) { return (x + 7) / 8 * 8; };
+
+   /** Fletcher like checksum over 64 bit words, fast enough to check each load.
+    *  The state is carried over, such that the arrays can be summed one after the other.
+    */
+   void graph_file_checksum(void const* const data, size_t const bytes, std::uint64_t& a, std::uint64_t& b)
+   {
+      auto const* p = static_cast<unsigned char const*>(data);
+      size_t      i = 0;
+
+      for(; i + sizeof(std::uint64_t) <= bytes; i += sizeof(std::uint64_t))
+      {
+         std::uint64_t w;
+
+         std::memcpy(&w, p + i, sizeof(w));
+         a += w;
+         b += a;
+      }
+      for(; i < bytes; i++)
+      {
+         a += p[i];
+         b += a;
+      }
+   }
+
+   std::uint64_t graph_file_checksum(void const* const data, size_t const bytes)
+   {
+      std::uint64_t a = 0;
+      std::uint64_t b = 0;
+
+      graph_file_checksum(data, bytes, a, b);
+
+      return a ^ (b << 1) ^ (b >> 63);
+   }
+}
+
+/** Write the graph into a binary file that can be loaded with map_binary().
+ */
+void Graph::save_binary(std::string const& filename) const
+{
+   using std::runtime_error;
+
+   assert(new_edges_.empty());
+
+   GraphFileHeader head {};
+
+   size_t const offsets_bytes = (node_count() + size_t(1)) * sizeof(arc_no_t);
+   size_t const heads_bytes   = arc_count() * sizeof(node_no_t);
+   size_t const dists_bytes   = arc_count() * sizeof(double);
+
+   std::memcpy(head.magic, GraphFileHeader::magic_id, sizeof(head.magic));
+   head.version      = GraphFileHeader::current_version;
+   head.node_no_size = sizeof(node_no_t);
+   head.arc_no_size  = sizeof(arc_no_t);
+   head.node_count   = node_count();
+   head.arc_count    = arc_count();
+   head.heads_offset = sizeof(head) + offsets_bytes;
+   head.dists_offset = round_up8(head.heads_offset + heads_bytes);
+
+   // Empty graphs have no offsets array
+   arc_no_t const  no_arcs     = 0;
+   arc_no_t const* offsets     = offsets_ == nullptr ? &no_arcs : offsets_;
+   char const      padding[8]  = {};
+   size_t const    pad_bytes   = head.dists_offset - head.heads_offset - heads_bytes;
+
+   std::uint64_t a = 0;
+   std::uint64_t b = 0;
+
+   graph_file_checksum(offsets, offsets_bytes, a, b);
+   graph_file_checksum(heads_,  heads_bytes,   a, b);
+   graph_file_checksum(padding, pad_bytes,     a, b);
+   graph_file_checksum(dists_,  dists_bytes,   a, b);
+
+   head.checksum = a ^ (b << 1) ^ (b >> 63);
+
+   std::ofstream output(filename, std::ios::binary | std::ios::trunc);
+
+   if (not output)
+      throw runtime_error("Cannot open file: " + filename);
+
+   output.write(reinterpret_cast<char const*>(&head), sizeof(head));
+   output.write(reinterpret_cast<char const*>(offsets), static_cast<std::streamsize>(offsets_bytes));
+   output.write(reinterpret_cast<char const*>(heads_), static_cast<std::streamsize>(heads_bytes));
+   output.write(padding, static_cast<std::streamsize>(pad_bytes));
+   output.write(reinterpret_cast<char const*>(dists_), static_cast<std::streamsize>(dists_bytes));
+
+   if (not output.flush())
+      throw runtime_error("Cannot write file: " + filename);
+}
+
+/** Load a graph written by save_binary(). The file stays mapped as long as
+ *  the graph or a copy of it uses it.
+ *  \param verify Check the checksum, this reads the whole file once.
+ */
+void Graph::map_binary(std::string const& filename, bool const verify)
+{
+   using std::runtime_error;
+
+   auto const file = std::make_shared<MappedFile const>(filename);
+
+   std::cout << "Mapping " << filename << std::endl;
+
+   GraphFileHeader head;
+
+   if (file->size() < sizeof(head))
+      throw runtime_error("Not a graph file: " + filename);
+
+   std::memcpy(&head, file->data(), sizeof(head));
+
+   if (std::memcmp(head.magic, GraphFileHeader::magic_id, sizeof(head.magic)) != 0)
+      throw runtime_error("Not a graph file: " + filename);
+
+   if (head.version != GraphFileHeader::current_version)
+      throw runtime_error("Unsupported graph file version " + std::to_string(head.version) + ": " + filename);
+
+   if (head.node_no_size != sizeof(node_no_t) or head.arc_no_size != sizeof(arc_no_t))
+      throw runtime_error("Wrong number types in graph file: " + filename);
+
+   std::uint64_t const size = file->size();
+
+   if (head.node_count >= std::numeric_limits<node_no_size_t>::max()
+      or head.node_count >= (size - sizeof(head)) / sizeof(arc_no_t)
+      or head.heads_offset != sizeof(head) + (head.node_count + 1) * sizeof(arc_no_t)
+      or head.arc_count > (size - head.heads_offset) / (sizeof(node_no_t) + sizeof(double))
+      or head.dists_offset != round_up8(head.heads_offset + head.arc_count * sizeof(node_no_t))
+      or head.dists_offset + head.arc_count * sizeof(double) != size)
+      throw runtime_error("Truncated graph file: " + filename);
+
+   char const* const data = file->data();
+
+   if (verify and graph_file_checksum(data + sizeof(head), size - sizeof(head)) != head.checksum)
+      throw runtime_error("Checksum error in graph file: " + filename);
+
+   auto const* const offsets = reinterpret_cast<arc_no_t const*>(data + sizeof(head));
+
+   if (offsets[0] != 0 or offsets[head.node_count] != head.arc_count)
+      throw runtime_error("Corrupt graph file: " + filename);
+
+   new_edges_.clear();
+   coordinates_.clear();
+
+   node_count_ = static_cast<node_no_size_t>(head.node_count);
+   offsets_    = offsets;
+   heads_      = reinterpret_cast<node_no_t const*>(data + head.heads_offset);
+   dists_      = reinterpret_cast<double const*>(data + head.dists_offset);
+   storage_    = file;
+
+   info();
+}
@@ -4,4 +4,17 @@ for i in data/*.gph gibtesnich.gph
 do
     $1 $4 $3 $4 $i 22 88
 done
+$1 data/b15.gph 1 100 b15.gphb
+$1 b15.gphb 1 100
+rm -f b15.gphb
+$1 data/grid5.gph 1 25
+$1 data/twocomp.gph 1 9
+$1 data/fractional.gph 1 24
+$1 data/fractional.gph 11 24 dary_heap
+for q in binary_heap radix_heap dial dary_heap; do $1 data/b15.gph 1 100 $q; done
+$1 data/long_edge.gph 1 3 radix_heap
+$1 data/long_edge.gph 1 3 dial
+$1 data/b15.gph 1 100 radix
+$1 data/grid5.gph 1 25 data/grid5.xy
+$1 data/grid5.gph 1 25 data/err_coordinates.xy
 exit 0
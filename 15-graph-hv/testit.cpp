@@ -14,6 +14,8 @@
 #include <iterator>
 #include <algorithm>
 #include <exception>
+#include <cmath>
+#include <cassert>
 
 #include "graph.hpp"
 
@@ -26,18 +28,66 @@ int main(int const argc, char const* const* const argv)
    using std::chrono::duration;
    using std::chrono::milliseconds;
 
+   auto const has_suffix = [](string const& name, string const& suffix)
+   {
+      return name.size() > suffix.size() and name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+   };
+
+   // Sums of fractional lengths in a different order may differ in the last bits, tolerance as in dijkstra_bench
+   [[maybe_unused]] auto const same_length = [](double a, double b)
+   {
+      return a == b or abs(a - b) <= 1e-9 * max(1.0, abs(b));
+   };
+
    try
    {
       cout << "Graph routines test driver, Version 1.2.0, 03Dez2022\n";
    
       if (argc < 3)
       {
-         cerr << "usage: " << argv[0] << " filename.gph start_node end_node" << endl;
+         cerr << "usage: " << argv[0] << " filename.gph|filename.gphb start_node end_node [snapshot.gphb] [coordinates.xy] [binary_heap|radix_heap|dial|dary_heap]" << endl;
          return -1;
       }
-      Graph g;
-
-      g.read(argv[1]);
+      struct QueueName
+      {
+         char const*   name;
+         DijkstraQueue queue;
+      };
+      QueueName const queue_names[] =
+      {
+         { "binary_heap", DijkstraQueue::binary_heap },
+         { "radix_heap",  DijkstraQueue::radix_heap  },
+         { "dial",        DijkstraQueue::dial        },
+         { "dary_heap",   DijkstraQueue::dary_heap   }
+      };
+      QueueName const* dijkstra_queue = &queue_names[0]; // Queue for the full run of Dijkstra from start_node
+
+      Graph        g;
+      string const filename = argv[1];
+
+      // .gphb is the binary snapshot written by save_binary()
+      if (has_suffix(filename, ".gphb"))
+         g.map_binary(filename);
+      else
+         g.read(filename);
+
+      // With coordinates the shortest path is computed with A*
+      for(int i = 4; i < argc; i++)
+      {
+         auto const q = find_if(begin(queue_names), end(queue_names), [&](QueueName const& n) { return argv[i] == string(n.name); });
+
+         if (q != end(queue_names))
+            dijkstra_queue = q;
+         else if (has_suffix(argv[i], ".xy"))
+            g.read_coordinates(argv[i]);
+         else if (has_suffix(argv[i], ".gphb"))
+            g.save_binary(argv[i]);
+         else
+         {
+            cerr << "Unknown argument " << argv[i] << endl;
+            return -1;
+         }
+      }
    
       auto const arg1       = stoll(argv[2]);
       auto const arg2       = stoll(argv[3]);
@@ -66,29 +116,45 @@ int main(int const argc, char const* const* const argv)
       }
       // Part II - Shortest path
       {
-         vector<double> dist(g.node_count(), Graph::invalid_value);
-
          auto const start_time_ms = high_resolution_clock::now();
 
          Graph::node_no_size_t num_components;
          cout << "MST= " << g.kruskal(num_components) << " [" << num_components << "] ";
 
-         g.dijkstra(start_node, dist, pred);
+         Graph::ShortestPath const sp = g.has_coordinates()
+            ? g.astar(start_node, end_node, g.euclidean_heuristic(end_node))
+            : g.bidirectional_dijkstra(start_node, end_node);
 
-         cout << "SP= " << dist[end_node] << " Path:";
+         cout << "SP= " << sp.dist << " Path:";
 
-         vector<Graph::node_no_t> path;
-         for(Graph::node_no_t i = end_node; pred[i] != Graph::invalid_node; i = pred[i])
-            path.push_back(i + 1);
-         path.push_back(start_node + 1);
-      
-         reverse(path.begin(), path.end());
-      
-         for(auto i : path)
-            cout << " " << i;
+         for(auto i : sp.path)
+            cout << " " << i + 1;
       
          cout << endl;
 
+         // The point to point query has to agree with the full shortest path tree
+         vector<double> dist(g.node_count());
+
+         g.dijkstra(start_node, dist, pred, true, dijkstra_queue->queue);
+
+         cout << "Dijkstra " << dijkstra_queue->name << " SP= " << dist[end_node] << endl;
+
+         assert(same_length(sp.dist, dist[end_node]));
+         assert(sp.path.empty() or (sp.path.front() == start_node and sp.path.back() == end_node));
+
+         [[maybe_unused]] double path_length = 0.0;
+
+         for(size_t k = 1; k < sp.path.size(); k++)
+         {
+            auto const neighbors = g.get_node(sp.path[k - 1]).adjacent_nodes();
+            auto const arc       = find(neighbors.begin(), neighbors.end(), Graph::Neighbor(sp.path[k], 0.0));
+
+            assert(arc != neighbors.end());
+
+            path_length += (*arc).dist();
+         }
+         assert(sp.path.empty() or same_length(path_length, sp.dist));
+
          duration<double, milli> const duration_ms = high_resolution_clock::now() - start_time_ms;
          cout << "Time: " << setprecision(0) << fixed << duration_ms.count() << " ms\n";
       }
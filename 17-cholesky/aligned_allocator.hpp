@@ -0,0 +1,133 @@
+/**
+ \file      aligned_allocator.hpp
+ \brief     Allocator for aligned matrix storage with optional huge pages and parallel first touch.
+ \author    Thorsten Koch
+ \version   1.0
+ \date      15Dec2022
+
+ Linux maps a page on the NUMA node of the thread that writes it first. If one thread
+ initializes a whole matrix, all of it ends up on one node. Therefore AlignedAllocator
+ does not initialize elements created without a value, and first_touch() zeroes large
+ arrays with a thread pool, one task per block of rows or tile. As the kernels steal
+ their tasks, a tile is not necessarily on the node of the thread that computes it,
+ but the pages are interleaved over the nodes and so is the memory traffic.
+*/
+
+#ifndef ALIGNED_ALLOCATOR_HPP
+#define ALIGNED_ALLOCATOR_HPP
+
+#include <cstdlib>
+#include <new>
+#include <limits>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include <cassert>
+
+#include <sys/mman.h>
+
+#include "threadpool.hpp"
+
+/** Process wide settings for the storage of new matrices.
+ */
+struct MemoryPolicy
+{
+   bool     huge_pages = false; //< Ask for transparent huge pages for allocations of at least 2MB
+   unsigned threads    = 1;     //< Number of threads for the first touch, best the number used for computing
+};
+
+constexpr size_t first_touch_parallel_bytes = size_t(4) << 20; //< Smaller arrays are zeroed by the calling thread
+
+
+inline MemoryPolicy& memory_policy()
+{
+   static MemoryPolicy policy;
+
+   return policy;
+}
+
+
+/** Allocator for storage aligned to Alignment bytes (at least a cache line).
+ *  Elements constructed without arguments, as by std::vector<T>(n) or resize(n), are default
+ *  initialized, i.e., for arithmetic types they are not written and keep arbitrary values.
+ */
+template <typename T, size_t Alignment = 64>
+class AlignedAllocator
+{
+public:
+   using value_type = T;
+
+   static constexpr size_t alignment      = std::max(Alignment, alignof(T));
+   static constexpr size_t huge_page_size = size_t(2) << 20;
+
+   template <typename U>
+   struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+   AlignedAllocator() noexcept = default;
+
+   template <typename U>
+   AlignedAllocator(AlignedAllocator<U, Alignment> const&) noexcept {}
+
+   T* allocate(size_t n)
+   {
+      if (n > std::numeric_limits<size_t>::max() / sizeof(T) / 2)
+         throw std::bad_array_new_length();
+
+      size_t const bytes = std::max(n * sizeof(T), size_t(1));
+      bool   const huge  = memory_policy().huge_pages and bytes >= huge_page_size;
+      size_t const align = huge ? huge_page_size : alignment;
+      size_t const size  = (bytes + align - 1) / align * align; // aligned_alloc wants a multiple of align
+      void*  const p     = std::aligned_alloc(align, size);
+
+      if (p == nullptr)
+         throw std::bad_alloc();
+
+      if (huge)
+         madvise(p, size, MADV_HUGEPAGE); // Only a hint, fails without transparent huge page support
+
+      return static_cast<T*>(p);
+   }
+
+   void deallocate(T* p, size_t) noexcept { std::free(p); }
+
+   template <typename U>
+   void construct(U* p) noexcept(std::is_nothrow_default_constructible_v<U>) { ::new(static_cast<void*>(p)) U; }
+
+   template <typename U, typename... Args>
+   void construct(U* p, Args&&... args) { ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...); }
+
+   template <typename U>
+   bool operator==(AlignedAllocator<U, Alignment> const&) const noexcept { return true; }
+
+   template <typename U>
+   bool operator!=(AlignedAllocator<U, Alignment> const&) const noexcept { return false; }
+};
+
+
+/** Zero the rows x cols row-major array a. From first_touch_parallel_bytes on, each block of
+ *  block_rows rows is a task for a pool of threads, such that the pages are spread over their nodes.
+ *  Below, starting the threads takes longer than writing the array.
+ */
+template <typename T>
+void first_touch(T* const a, size_t const rows, size_t const cols, unsigned const threads, size_t const block_rows)
+{
+   assert(block_rows > 0);
+
+   if (threads <= 1 or rows <= block_rows or rows * cols * sizeof(T) < first_touch_parallel_bytes)
+   {
+      std::fill_n(a, rows * cols, T(0.0));
+      return;
+   }
+   ThreadPool pool(threads);
+
+   for(size_t r0 = 0; r0 < rows; r0 += block_rows)
+   {
+      size_t const r1 = std::min(r0 + block_rows, rows);
+
+      pool.submit([a, r0, r1, cols] { std::fill_n(a + r0 * cols, (r1 - r0) * cols, T(0.0)); });
+   }
+   pool.wait();
+}
+
+#endif // !ALIGNED_ALLOCATOR_HPP
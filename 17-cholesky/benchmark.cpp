@@ -0,0 +1,284 @@
+/**
+ \file      benchmark.cpp
+ \brief     Benchmark for the dense kernels of the Matrix/Cholesky template class
+ \author    Thorsten Koch
+ \version   1.0
+ \date      15Dec2022
+
+ Each kernel is run warmup times without measuring and then repeats times. Reported
+ are the median and the minimum time, the GFLOP/s and the bandwidth, both from the
+ median. The bandwidth assumes each matrix element is read or written once, which is
+ the least traffic the operation needs. The results can be written as CSV and JSON.
+ make bench builds with -Ofast. DoubleDouble keeps its error terms under fast-math by
+ itself and is inlined like the other types, so its times are comparable to theirs.
+*/
+
+#include <chrono>
+#include <functional>
+#include <sstream>
+
+#include "matrix.hpp"
+#include "double_double.hpp"
+
+using namespace std;
+
+using quad = __float128;
+
+constexpr unsigned default_seed = 20010313U; // arbitrary number
+constexpr size_t   multi_rhs    = 16;        // right-hand sides of the multi_solve kernel
+
+
+struct BenchmarkResult
+{
+   string kernel;
+   string precision;
+   size_t size;
+   double median_ms;
+   double min_ms;
+   double gflops;      //< Floating point operations per second / 10^9
+   double gbytes;      //< Bytes per second / 10^9
+};
+
+
+struct BenchmarkOptions
+{
+   vector<size_t> sizes      = { 128, 512, 1024 };
+   vector<string> precisions = { "float", "double" };
+   size_t         warmup     = 1;
+   size_t         repeats    = 5;
+   unsigned       threads    = 1;
+   bool           huge_pages = false;
+   string         csv_file;
+   string         json_file;
+};
+
+
+/** Run f warmup + repeats times.
+ *  \return Median and minimum time of the measured runs in milliseconds.
+ */
+pair<double, double> measure(function<void()> const& f, size_t const warmup, size_t const repeats)
+{
+   using std::chrono::high_resolution_clock;
+   using std::chrono::duration;
+
+   assert(repeats > 0);
+
+   for(size_t r = 0; r < warmup; r++)
+      f();
+
+   vector<double> times_ms(repeats);
+
+   for(auto& t : times_ms)
+   {
+      auto const start_time_ms = high_resolution_clock::now();
+
+      f();
+
+      duration<double, std::milli> const duration_ms = high_resolution_clock::now() - start_time_ms;
+
+      t = duration_ms.count();
+   }
+   sort(times_ms.begin(), times_ms.end());
+
+   double const median = repeats % 2 == 1 ? times_ms[repeats / 2] : (times_ms[repeats / 2 - 1] + times_ms[repeats / 2]) / 2.0;
+
+   return { median, times_ms.front() };
+}
+
+
+/** Benchmark all kernels for n x n matrices with elements of type Value_T.
+ */
+template <typename Value_T>
+void benchmark(string const& precision, size_t const n, BenchmarkOptions const& opt, vector<BenchmarkResult>& results)
+{
+   double const elements = static_cast<double>(n) * static_cast<double>(n);
+   double const bytes    = elements * sizeof(Value_T);
+   double const dn       = static_cast<double>(n);
+
+   // Well conditioned, such that the Cholesky decomposition works for all precisions
+   Matrix<Value_T> aa = Matrix<Value_T>(n, default_seed).syrk(opt.threads);
+
+   for(size_t i = 0; i < n; i++)
+      aa(i, i) += static_cast<Value_T>(static_cast<double>(n));
+
+   Matrix<Value_T> const      l = aa.cholesky(0, opt.threads);
+   vector<Value_T> const      b(n, 1.0);
+   vector<Value_T>            x;
+   vector<vector<Value_T>>    bs(multi_rhs, b);
+   vector<vector<Value_T>>    xs;
+   Matrix<Value_T>            c;
+   Matrix<Value_T>            t(aa);
+   ResidualNorms<Value_T>     res {};
+
+   auto run = [&](string const& kernel, double const flops, double const traffic, function<void()> const& f)
+   {
+      auto const [median_ms, min_ms] = measure(f, opt.warmup, opt.repeats);
+
+      results.push_back({ kernel, precision, n, median_ms, min_ms, flops / median_ms / 1e6, traffic / median_ms / 1e6 });
+
+      auto const& r = results.back();
+
+      cout << left  << setw(18) << r.kernel << setw(12) << r.precision << right << setw(6) << r.size;
+      cout << setw(12) << fixed << setprecision(3) << r.median_ms << setw(12) << r.min_ms;
+      cout << setw(10) << setprecision(2) << r.gflops << setw(10) << r.gbytes << endl;
+   };
+   run("cholesky",          dn * dn * dn / 3.0, bytes,       [&] { c = aa.cholesky(0, opt.threads); });
+   run("gemm",              2.0 * dn * dn * dn, 3.0 * bytes, [&] { c = multiply(aa, l, opt.threads); });
+   run("syrk",              dn * dn * dn,       2.0 * bytes, [&] { c = l.syrk(opt.threads); });
+   run("transpose",         0.0,                2.0 * bytes, [&] { c = aa.transpose(); });
+   run("transpose_inplace", 0.0,                2.0 * bytes, [&] { t.transpose_inplace(); });
+   run("triangular_solve",  2.0 * dn * dn,      bytes,       [&] { x = l.triangular_solve(b); });
+   run("multi_solve",       2.0 * dn * dn * multi_rhs, bytes + 2.0 * dn * multi_rhs * sizeof(Value_T), [&] { xs = l.triangular_solve(bs); });
+   run("residual",          2.0 * dn * dn,      bytes,       [&] { res = residual_norms(aa, x, b); });
+}
+
+
+void write_csv(string const& filename, BenchmarkOptions const& opt, vector<BenchmarkResult> const& results)
+{
+   ofstream out(filename);
+
+   if (not out)
+      throw runtime_error("Cannot open file: " + filename);
+
+   out << "kernel,precision,n,threads,repeats,median_ms,min_ms,gflops,gbytes_per_s\n";
+
+   for(auto const& r : results)
+      out << r.kernel << "," << r.precision << "," << r.size << "," << opt.threads << "," << opt.repeats << ","
+          << setprecision(6) << r.median_ms << "," << r.min_ms << "," << r.gflops << "," << r.gbytes << "\n";
+
+   if (not out.flush())
+      throw runtime_error("Cannot write file: " + filename);
+}
+
+
+void write_json(string const& filename, BenchmarkOptions const& opt, vector<BenchmarkResult> const& results)
+{
+   ofstream out(filename);
+
+   if (not out)
+      throw runtime_error("Cannot open file: " + filename);
+
+   out << "{\n  \"threads\": " << opt.threads << ",\n  \"warmup\": " << opt.warmup << ",\n  \"repeats\": " << opt.repeats;
+   out << ",\n  \"results\": [\n";
+
+   for(size_t i = 0; i < results.size(); i++)
+   {
+      auto const& r = results[i];
+
+      out << "    { \"kernel\": \"" << r.kernel << "\", \"precision\": \"" << r.precision << "\", \"n\": " << r.size
+          << setprecision(6) << ", \"median_ms\": " << r.median_ms << ", \"min_ms\": " << r.min_ms
+          << ", \"gflops\": " << r.gflops << ", \"gbytes_per_s\": " << r.gbytes << " }"
+          << (i + 1 < results.size() ? ",\n" : "\n");
+   }
+   out << "  ]\n}\n";
+
+   if (not out.flush())
+      throw runtime_error("Cannot write file: " + filename);
+}
+
+
+// "a,b,c" -> { "a", "b", "c" }
+vector<string> split_list(string const& list)
+{
+   vector<string> items;
+   stringstream   in(list);
+   string         item;
+
+   while(getline(in, item, ','))
+      items.push_back(item);
+
+   return items;
+}
+
+
+/** Benchmark driver.
+ *
+ * ./benchmark [-n sizes] [-p precisions] [-w warmup] [-r repeats] [-t threads] [-h hugepages] [-c file.csv] [-j file.json]
+ *    sizes       Comma separated matrix sizes, default 128,512,1024.
+ *    precisions  Comma separated from float, double, long-double, quad, double-double, default float,double.
+ *    warmup      Runs before measuring, default 1.
+ *    repeats     Measured runs, default 5.
+ *    threads     Threads for cholesky, gemm and syrk, default 1.
+ *    hugepages   1 = ask for transparent huge pages for the matrices, default 0.
+ */
+int main(int argc, char const* const* const argv)
+{
+   try
+   {
+      BenchmarkOptions opt;
+
+      for(int i = 1; i < argc; i += 2)
+      {
+         string const option = argv[i];
+
+         if (i + 1 >= argc)
+            throw runtime_error("Missing value for option " + option);
+
+         string const value = argv[i + 1];
+
+         if (option == "-n")
+         {
+            opt.sizes.clear();
+
+            for(auto const& s : split_list(value))
+               opt.sizes.push_back(stoul(s));
+         }
+         else if (option == "-p")
+            opt.precisions = split_list(value);
+         else if (option == "-w")
+            opt.warmup = stoul(value);
+         else if (option == "-r")
+            opt.repeats = stoul(value);
+         else if (option == "-t")
+            opt.threads = static_cast<unsigned>(stoul(value));
+         else if (option == "-h")
+            opt.huge_pages = stoul(value) != 0;
+         else if (option == "-c")
+            opt.csv_file = value;
+         else if (option == "-j")
+            opt.json_file = value;
+         else
+            throw runtime_error("Unknown option " + option);
+      }
+      if (opt.repeats < 1 or opt.threads < 1 or opt.sizes.empty())
+      {
+         cerr << "usage: " << argv[0] << " [-n sizes] [-p precisions] [-w warmup] [-r repeats] [-t threads] [-h hugepages] [-c file.csv] [-j file.json]\n";
+         return -1;
+      }
+      memory_policy().threads    = opt.threads;
+      memory_policy().huge_pages = opt.huge_pages;
+
+      vector<BenchmarkResult> results;
+
+      cout << "kernel            precision      n   median[ms]     min[ms]   GFLOP/s      GB/s\n";
+
+      for(auto const& precision : opt.precisions)
+      {
+         for(size_t n : opt.sizes)
+         {
+            if (precision == "float")
+               benchmark<float>(precision, n, opt, results);
+            else if (precision == "double")
+               benchmark<double>(precision, n, opt, results);
+            else if (precision == "long-double")
+               benchmark<long double>(precision, n, opt, results);
+            else if (precision == "quad")
+               benchmark<quad>(precision, n, opt, results);
+            else if (precision == "double-double")
+               benchmark<DoubleDouble>(precision, n, opt, results);
+            else
+               throw runtime_error("Unknown precision " + precision);
+         }
+      }
+      if (not opt.csv_file.empty())
+         write_csv(opt.csv_file, opt, results);
+
+      if (not opt.json_file.empty())
+         write_json(opt.json_file, opt, results);
+   }
+   catch(exception const& e)
+   {
+      cerr << argv[0] << ": Exception " << e.what() << " -- aborting\n";
+      return -1;
+   }
+}
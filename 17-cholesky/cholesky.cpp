@@ -9,6 +9,13 @@
 #include <chrono>
 
 #include "matrix.hpp"
+#include "sparse_cholesky.hpp"
+#include "mixed_precision.hpp"
+#include "ldlt.hpp"
+#include "pivoted_cholesky.hpp"
+#include "cholesky_update.hpp"
+#include "double_double.hpp"
+#include "fixed_matrix.hpp"
 
 using namespace std;
 
@@ -30,7 +37,9 @@ template <typename Value_T>
 void test(
    string const& text,
    size_t const  beg,
-   size_t const  end)
+   size_t const  end,
+   size_t const  block_size,
+   unsigned const threads)
 {
    using std::chrono::high_resolution_clock;
    using std::chrono::duration_cast;
@@ -46,68 +55,702 @@ void test(
       cout << setw(4) << n << " ";
 
       vector<Value_T> r(n, 1.0);
-      Matrix<Value_T> a(n, default_seed); 
 
-      auto const a_t = a.transpose();
-      auto const aa  = a * a_t;
+      // A and A^t are released right after the multiplication
+      auto const aa = [&]()
+      {
+         Matrix<Value_T> const a(n, default_seed);
+
+         return a.syrk(threads);
+      }();
       
       auto const start_time_ms = high_resolution_clock::now();
 
-      auto const l = aa.cholesky();
+      auto const l = aa.cholesky_packed(block_size, threads);
       auto const x = l.triangular_solve(r);
 
       duration<double, std::milli> const duration_ms = high_resolution_clock::now() - start_time_ms;
 
-      auto const t = aa * x;
+      auto const res = residual_norms(aa, x, r);
+
+      cout << setw(16) << fixed << setprecision(12) << res.max_norm;
+      cout << setw(16) << fixed << setprecision(12) << res.two_norm;
+      cout << setw(9)  << fixed << setprecision(3)  << duration_ms.count() << endl; 
+   }
+   cout << endl;
+}
+
+
+/** Same as test(), but factorize in Low_T and refine the solution in High_T up to tolerance.
+ */
+template <typename Low_T, typename High_T>
+void test_mixed(
+   string const&  text,
+   size_t const   beg,
+   size_t const   end,
+   size_t const   block_size,
+   unsigned const threads,
+   High_T const   tolerance)
+{
+   using std::chrono::high_resolution_clock;
+   using std::chrono::duration;
+
+   assert(beg < end);
+   
+   cout << text << endl;
+   cout << "   N         max-norm        two-norm time[ms] iter\n";
+   for(size_t n = beg; n < end; ++n)
+   {
+      cout << setw(4) << n << " ";
+
+      vector<High_T> r(n, 1.0);
+
+      auto const aa = [&]()
+      {
+         Matrix<High_T> const a(n, default_seed);
+
+         return a.syrk(threads);
+      }();
+      
+      auto const start_time_ms = high_resolution_clock::now();
+
+      auto const result = mixed_precision_solve<Low_T>(aa, r, tolerance, 30, block_size, threads);
+
+      duration<double, std::milli> const duration_ms = high_resolution_clock::now() - start_time_ms;
+
+      auto const res = residual_norms(aa, result.x, r);
+
+      cout << setw(16) << fixed << setprecision(12) << res.max_norm;
+      cout << setw(16) << fixed << setprecision(12) << res.two_norm;
+      cout << setw(9)  << fixed << setprecision(3)  << duration_ms.count();
+      cout << setw(5)  << result.iterations << (result.converged ? "" : " not converged") << endl; 
+   }
+   cout << endl;
+}
+
+
+/** Same as test(), but solve k right-hand sides at once and compare with k single solves.
+ *  Right-hand side j is the constant vector j + 1. Prints the largest max-norm residual,
+ *  the largest difference to the single solves and the times of both. The difference also
+ *  covers the first columns of the solve with an n x n matrix of right-hand sides.
+ */
+template <typename Value_T>
+void test_multi_rhs(
+   string const& text,
+   size_t const  beg,
+   size_t const  end,
+   size_t const  block_size,
+   unsigned const threads,
+   size_t const  k)
+{
+   using std::chrono::high_resolution_clock;
+   using std::chrono::duration;
+
+   assert(beg < end);
+   
+   cout << text << ", " << k << " Right-hand sides" << endl;
+   cout << "   N         max-norm      difference  multi[ms] single[ms]\n";
+   for(size_t n = beg; n < end; ++n)
+   {
+      cout << setw(4) << n << " ";
+
+      vector<vector<Value_T>> bs(k);
+
+      for(size_t j = 0; j < k; j++)
+         bs[j].assign(n, static_cast<Value_T>(j + 1));
+
+      auto const aa = Matrix<Value_T>(n, default_seed).syrk(threads);
+      auto const l  = aa.cholesky(block_size, threads);
+      
+      auto const multi_start = high_resolution_clock::now();
+
+      auto const xs = l.triangular_solve(bs);
+
+      auto const single_start = high_resolution_clock::now();
+
+      vector<vector<Value_T>> xs_single(k);
+
+      for(size_t j = 0; j < k; j++)
+         xs_single[j] = l.triangular_solve(bs[j]);
+
+      auto const single_end = high_resolution_clock::now();
+
+      Matrix<Value_T> b_matrix(n);
+
+      for(size_t i = 0; i < n; i++)
+         for(size_t j = 0; j < n; j++)
+            b_matrix(i, j) = static_cast<Value_T>(j + 1);
+
+      auto const x_matrix = l.triangular_solve(b_matrix);
+
+      Value_T max_res  = 0.0;
+      Value_T max_diff = 0.0;
+
+      for(size_t j = 0; j < k; j++)
+      {
+         max_res  = std::max(max_res,  residual_norms(aa, xs[j], bs[j]).max_norm);
+         max_diff = std::max(max_diff, max_norm(xs[j] - xs_single[j]));
+
+         for(size_t i = 0; i < n and j < n; i++)
+            max_diff = std::max(max_diff, absval(x_matrix(i, j) - xs_single[j][i]));
+      }
+      duration<double, std::milli> const multi_ms  = single_start - multi_start;
+      duration<double, std::milli> const single_ms = single_end   - single_start;
+
+      cout << setw(16) << fixed << setprecision(12) << max_res;
+      cout << setw(16) << fixed << setprecision(12) << max_diff;
+      cout << setw(11) << fixed << setprecision(3)  << multi_ms.count();
+      cout << setw(11) << fixed << setprecision(3)  << single_ms.count() << endl; 
+   }
+   cout << endl;
+}
+
+
+/** Same as test(), but with the LDL^t decomposition.
+ *  If indefinite, the diagonal is replaced by one of alternating sign that dominates each row,
+ *  such that the matrix has about as many negative as positive eigenvalues.
+ */
+template <typename Value_T>
+void test_ldlt(
+   string const& text,
+   size_t const  beg,
+   size_t const  end,
+   size_t const  block_size,
+   bool const    indefinite)
+{
+   using std::chrono::high_resolution_clock;
+   using std::chrono::duration;
+
+   assert(beg < end);
+   
+   cout << text << endl;
+   cout << "   N         max-norm        two-norm time[ms]\n";
+   for(size_t n = beg; n < end; ++n)
+   {
+      cout << setw(4) << n << " ";
+
+      vector<Value_T> r(n, 1.0);
+
+      auto const aa = [&]()
+      {
+         auto a = Matrix<Value_T>(n, default_seed).syrk();
+
+         if (indefinite)
+         {
+            for(size_t i = 0; i < n; i++)
+            {
+               Value_T row_sum = 1.0;
+
+               for(size_t j = 0; j < n; j++)
+                  if (j != i)
+                     row_sum += absval(a(i, j));
+
+               a(i, i) = i % 2 == 0 ? row_sum : -row_sum;
+            }
+         }
+         return a;
+      }();
+      
+      auto const start_time_ms = high_resolution_clock::now();
+
+      auto const f = ldlt(aa, block_size);
+      auto const x = f.solve(r);
+
+      duration<double, std::milli> const duration_ms = high_resolution_clock::now() - start_time_ms;
+
+      auto const res = residual_norms(aa, x, r);
 
-      cout << setw(16) << fixed << setprecision(12) << max_norm(r - t);
-      cout << setw(16) << fixed << setprecision(12) << two_norm(r - t);
+      cout << setw(16) << fixed << setprecision(12) << res.max_norm;
+      cout << setw(16) << fixed << setprecision(12) << res.two_norm;
       cout << setw(9)  << fixed << setprecision(3)  << duration_ms.count() << endl; 
    }
    cout << endl;
 }
 
 
+/** Pivoted Cholesky decomposition of semi-definite matrices A A^t, where A has only n / 2 nonzero columns.
+ *  The right-hand side is A A^t 1, such that the system has a solution.
+ */
+template <typename Value_T>
+void test_pivoted(
+   string const& text,
+   size_t const  beg,
+   size_t const  end,
+   size_t const  block_size)
+{
+   using std::chrono::high_resolution_clock;
+   using std::chrono::duration;
+
+   assert(beg < end);
+   
+   cout << text << endl;
+   cout << "   N         max-norm        two-norm time[ms] rank\n";
+   for(size_t n = beg; n < end; ++n)
+   {
+      cout << setw(4) << n << " ";
+
+      auto const aa = [&]()
+      {
+         Matrix<Value_T> a(n, default_seed);
+
+         for(size_t i = 0; i < n; i++)
+            for(size_t j = n / 2; j < n; j++)
+               a(i, j) = 0.0;
+
+         return a.syrk();
+      }();
+      vector<Value_T> const r = aa * vector<Value_T>(n, 1.0);
+      
+      auto const start_time_ms = high_resolution_clock::now();
+
+      auto const f = pivoted_cholesky(aa, Value_T(-1.0), block_size);
+      auto const x = f.solve(r);
+
+      duration<double, std::milli> const duration_ms = high_resolution_clock::now() - start_time_ms;
+
+      auto const res = residual_norms(aa, x, r);
+
+      cout << setw(16) << fixed << setprecision(12) << res.max_norm;
+      cout << setw(16) << fixed << setprecision(12) << res.two_norm;
+      cout << setw(9)  << fixed << setprecision(3)  << duration_ms.count();
+      cout << setw(5)  << f.rank << endl; 
+   }
+   cout << endl;
+}
+
+
+/** Modify factors instead of factorizing again: the factor of the leading n - 1 rows
+ *  is grown by the last row, then updated for A + vv^t and downdated back to A.
+ *  Prints the max-norm residuals of the three solves and the time for the three changes.
+ */
+template <typename Value_T>
+void test_update(
+   string const& text,
+   size_t const  beg,
+   size_t const  end)
+{
+   using std::chrono::high_resolution_clock;
+   using std::chrono::duration;
+
+   assert(beg < end);
+   
+   cout << text << endl;
+   cout << "   N           append          update        downdate time[ms]\n";
+   for(size_t n = beg; n < end; ++n)
+   {
+      cout << setw(4) << n << " ";
+
+      vector<Value_T> r(n, 1.0);
+
+      auto const aa = Matrix<Value_T>(n, default_seed).syrk();
+      
+      Matrix<Value_T> a_1(n - 1);
+
+      for(size_t i = 0; i < n - 1; i++)
+         std::copy_n(&aa(i, 0), n - 1, &a_1(i, 0));
+
+      vector<Value_T> const a_n(&aa(n - 1, 0), &aa(n - 1, 0) + n);
+      vector<Value_T>       v(n);
+
+      for(size_t i = 0; i < n; i++)
+         v[i] = Value_T(1.0) / static_cast<Value_T>(i + 1);
+
+      Matrix<Value_T> aa_v(aa);
+
+      for(size_t i = 0; i < n; i++)
+         for(size_t j = 0; j < n; j++)
+            aa_v(i, j) += v[i] * v[j];
+
+      Matrix<Value_T> l = std::move(a_1).cholesky();
+
+      auto const start_time_ms = high_resolution_clock::now();
+
+      cholesky_append(l, a_n);
+      auto const x_append = l.triangular_solve(r);
+      cholesky_update(l, v);
+      auto const x_update = l.triangular_solve(r);
+      cholesky_downdate(l, v);
+      auto const x_downdate = l.triangular_solve(r);
+
+      duration<double, std::milli> const duration_ms = high_resolution_clock::now() - start_time_ms;
+
+      cout << setw(16) << fixed << setprecision(12) << residual_norms(aa,   x_append,   r).max_norm;
+      cout << setw(16) << fixed << setprecision(12) << residual_norms(aa_v, x_update,   r).max_norm;
+      cout << setw(16) << fixed << setprecision(12) << residual_norms(aa,   x_downdate, r).max_norm;
+      cout << setw(9)  << fixed << setprecision(3)  << duration_ms.count() << endl; 
+   }
+   cout << endl;
+}
+
+
+/** Read the sparse matrix A, factorize A A^t with the sparse Cholesky and solve for constant vector 2.
+ */
+void sparse_test(string const& filename)
+{
+   using std::chrono::high_resolution_clock;
+   using std::chrono::duration;
+
+   SparseMatrix<double> a;
+
+   a.read(filename);
+
+   auto const aa = a.multiply_transpose();
+   
+   auto const start_time_ms = high_resolution_clock::now();
+
+   SparseCholesky<double> const l(aa);
+   
+   vector<double> const b(aa.size(), 2);
+   auto const           x = l.solve(b);
+
+   duration<double, std::milli> const duration_ms = high_resolution_clock::now() - start_time_ms;
+
+   vector<double> const y = aa * x;
+
+   cout << "AA^t has " << aa.nonzeros() << " nonzeros, L has " << l.nonzeros()
+        << " nonzeros in " << l.supernodes() << " supernodes\n";
+   cout << "Error max norm= " << setprecision(12) << max_norm(y - b) << endl;
+   cout << "Error two norm= " << setprecision(12) << two_norm(y - b) << endl;
+   cout << "Time[ms]= " << fixed << setprecision(3) << duration_ms.count() << endl; 
+}
+
+
+/** Read the symmetric matrix A, of which only the lower triangle is used,
+ *  and solve Ax = 2 with the LDL^t decomposition. A need not be positive definite.
+ */
+void ldlt_test(string const& filename)
+{
+   Matrix<double> a;
+
+   a.read(filename);
+
+   for(size_t i = 0; i < a.size(); i++)
+      for(size_t j = 0; j < i; j++)
+         a(j, i) = a(i, j);
+
+   auto const f = ldlt(a);
+
+   vector<double> const b(a.size(), 2);
+   auto const           x = f.solve(b);
+   vector<double> const y = a * x;
+
+   size_t const negative = static_cast<size_t>(count_if(f.d.begin(), f.d.end(), [](double d) { return d < 0.0; }));
+
+   cout << "D has " << negative << " negative entries\n";
+   cout << "Error max norm= " << setprecision(12) << max_norm(y - b) << endl;
+   cout << "Error two norm= " << setprecision(12) << two_norm(y - b) << endl;
+}
+
+
+/** Read the matrix A and solve AA^t x = 2 with the Cholesky factor kept in factor_file.
+ *  If the file exists, the factor is mapped from it, otherwise it is computed and written.
+ */
+void factor_file_test(string const& filename, string const& factor_file)
+{
+   using std::chrono::high_resolution_clock;
+   using std::chrono::duration;
+
+   Matrix<double> a;
+
+   a.read(filename);
+
+   auto const aa = a.syrk();
+   
+   if (not ifstream(factor_file))
+   {
+      aa.cholesky().save_binary(factor_file);
+      cout << "Wrote factor to " << factor_file << endl;
+   }
+   auto const start_time_ms = high_resolution_clock::now();
+
+   MappedMatrix<double> const l(factor_file);
+
+   if (l.size() != aa.size())
+      throw runtime_error("Factor in " + factor_file + " does not fit to " + filename);
+
+   vector<double> const b(aa.size(), 2);
+   auto const           x = l.triangular_solve(b);
+
+   duration<double, std::milli> const duration_ms = high_resolution_clock::now() - start_time_ms;
+
+   vector<double> const y = aa * x;
+
+   cout << "Mapped factor from " << factor_file << endl;
+   cout << "Error max norm= " << setprecision(12) << max_norm(y - b) << endl;
+   cout << "Error two norm= " << setprecision(12) << two_norm(y - b) << endl;
+   cout << "Time[ms]= " << fixed << setprecision(3) << duration_ms.count() << endl; 
+}
+
+
+/** Solve count random N x N systems L L^t + N I with constant vector 1, with Matrix<double>,
+ *  with FixedMatrix and with FixedMatrixBatch. Prints the largest max-norm residual
+ *  of all three and their times for all systems.
+ */
+template <size_t N>
+void test_fixed(size_t const count)
+{
+   using std::chrono::high_resolution_clock;
+   using std::chrono::duration;
+
+   std::mt19937                           rng(default_seed);
+   std::uniform_real_distribution<double> dist(0.0, 1.0);
+   vector<FixedMatrix<double, N>>         as(count);
+
+   for(auto& a : as)
+   {
+      FixedMatrix<double, N> l;
+
+      for(size_t i = 0; i < N; i++)
+         for(size_t j = 0; j <= i; j++)
+            l(i, j) = dist(rng);
+
+      for(size_t i = 0; i < N; i++)
+      {
+         for(size_t j = 0; j < N; j++)
+            for(size_t k = 0; k < N; k++)
+               a(i, j) += l(i, k) * l(j, k);
+
+         a(i, i) += N;
+      }
+   }
+   std::array<double, N> const           b  = [] { std::array<double, N> v; v.fill(1.0); return v; }();
+   vector<std::array<double, N>> const   bs(count, b);
+   FixedMatrixBatch<double, N>           batch(count);
+
+   for(size_t k = 0; k < count; k++)
+      batch.set(k, as[k]);
+
+   vector<std::array<double, N>> xs_matrix(count);
+   vector<std::array<double, N>> xs_fixed(count);
+   vector<std::array<double, N>> xs_batch(count);
+
+   auto const matrix_start = high_resolution_clock::now();
+
+   for(size_t k = 0; k < count; k++)
+   {
+      Matrix<double> m(N);
+
+      for(size_t i = 0; i < N; i++)
+         for(size_t j = 0; j < N; j++)
+            m(i, j) = as[k](i, j);
+
+      auto const x = std::move(m).cholesky().triangular_solve(vector<double>(b.begin(), b.end()));
+
+      std::copy(x.begin(), x.end(), xs_matrix[k].begin());
+   }
+   auto const fixed_start = high_resolution_clock::now();
+
+   for(size_t k = 0; k < count; k++)
+      xs_fixed[k] = as[k].cholesky().triangular_solve(b);
+
+   auto const batch_start = high_resolution_clock::now();
+
+   batch.cholesky();
+   batch.triangular_solve(bs, xs_batch);
+
+   auto const batch_end = high_resolution_clock::now();
+
+   auto max_residual = [&](vector<std::array<double, N>> const& xs)
+   {
+      double max_res = 0.0;
+
+      for(size_t k = 0; k < count; k++)
+      {
+         auto const y = as[k] * xs[k];
+
+         for(size_t i = 0; i < N; i++)
+            max_res = std::max(max_res, absval(y[i] - b[i]));
+      }
+      return max_res;
+   };
+   double const max_res = std::max({ max_residual(xs_matrix), max_residual(xs_fixed), max_residual(xs_batch) });
+
+   duration<double, std::milli> const matrix_ms = fixed_start - matrix_start;
+   duration<double, std::milli> const fixed_ms  = batch_start - fixed_start;
+   duration<double, std::milli> const batch_ms  = batch_end   - batch_start;
+
+   cout << setw(4)  << N;
+   cout << setw(17) << fixed << setprecision(12) << max_res;
+   cout << setw(11) << fixed << setprecision(3)  << matrix_ms.count();
+   cout << setw(10) << fixed << setprecision(3)  << fixed_ms.count();
+   cout << setw(10) << fixed << setprecision(3)  << batch_ms.count() << endl;
+}
+
+
+/** Run test_fixed() for the sizes from N to 16 that are in [beg, end).
+ */
+template <size_t N>
+void test_fixed_sizes(string const& text, size_t const beg, size_t const end, size_t const count)
+{
+   if constexpr (N == 1)
+   {
+      cout << text << ", " << count << " Systems" << endl;
+      cout << "   N         max-norm Matrix[ms] Fixed[ms] Batch[ms]\n";
+   }
+   if constexpr (N <= 16)
+   {
+      if (N >= beg and N < end)
+         test_fixed<N>(count);
+
+      test_fixed_sizes<N + 1>(text, beg, end, count);
+   }
+   else
+      cout << endl;
+}
+
+
+/** Read A in precision Value_T, factorize A A^t and solve for constant vector 2,
+ *  repeated to get a measurable time.
+ *  \return Time for one factorization and solve in milliseconds.
+ */
+template <typename Value_T>
+double precision_run(string const& text, string const& filename, size_t const repeats)
+{
+   using std::chrono::high_resolution_clock;
+   using std::chrono::duration;
+
+   Matrix<Value_T> a;
+
+   a.read(filename);
+
+   auto const            aa = a.syrk();
+   vector<Value_T> const b(aa.size(), 2.0);
+   vector<Value_T>       x;
+
+   auto const start_time_ms = high_resolution_clock::now();
+
+   for(size_t r = 0; r < repeats; r++)
+      x = aa.cholesky().triangular_solve(b);
+
+   duration<double, std::milli> const duration_ms = high_resolution_clock::now() - start_time_ms;
+
+   auto const res = residual_norms(aa, x, b);
+
+   cout << left << setw(15) << text << right;
+   cout << " max-norm= " << scientific << setprecision(3) << res.max_norm;
+   cout << " two-norm= " << scientific << setprecision(3) << res.two_norm;
+   cout << " time[ms]= " << fixed << setprecision(6) << duration_ms.count() / static_cast<double>(repeats) << endl;
+
+   return duration_ms.count() / static_cast<double>(repeats);
+}
+
+
+/** Compare double-double with quad precision for the matrix in filename.
+ */
+void precision_compare(string const& filename)
+{
+   constexpr size_t repeats = 1000;
+
+   double const dd_ms   = precision_run<DoubleDouble>("Double-Double", filename, repeats);
+   double const quad_ms = precision_run<quad>("Quad", filename, repeats);
+
+   cout << "Speedup= " << fixed << setprecision(1) << quad_ms / dd_ms << endl;
+}
+
+
 /** Testdriver for Cholesky decomposition.
  *
- *  There are three ways to call this routine:
+ *  There are seven ways to call this routine:
  * ./cholesky                     -> Will demonstracte decomposition according to example in the lecture slide
  * ./cholesky filename.mm         -> Will read in matrix filenanme.mm and solve for constant vector 2.
- * ./cholesky begin end precision -> For n = begin to end - 1 will generate a random matrix of size n and solve for constant vector 1.
- *                                   Precision: 1 = float, 2 = double, 3 = long double, 4 = quad precision.
+ * ./cholesky filename.mm sparse  -> Same, but keeps the matrix sparse and uses the sparse Cholesky.
+ * ./cholesky filename.mm factor factorfile
+ *                                -> Same, but the Cholesky factor is mapped from the binary file factorfile,
+ *                                   which is written first if it does not exist.
+ * ./cholesky filename.mm compare -> Same, in double-double and in quad precision, and compares the times.
+ * ./cholesky filename.mm ldlt    -> Solves Ax = 2 with the LDL^t decomposition, using the lower triangle of A.
+ * ./cholesky begin end precision [block size [threads [huge pages]]]
+ *                                -> For n = begin to end - 1 will generate a random matrix of size n and solve for constant vector 1.
+ *                                   Precision: 1 = float, 2 = double, 3 = long double, 4 = quad precision,
+ *                                   5 = float factor refined in double, 6 = double factor refined in quad precision,
+ *                                   7 = double LDL^t, 8 = double pivoted Cholesky of semi-definite matrices of rank n / 2,
+ *                                   9 = double factor grown by a row, updated and downdated by rank one,
+ *                                   10 = double-double precision, 11 = double fixed size matrices for n <= 16, single and batched,
+ *                                   12 = double with 8 right-hand sides solved at once and one by one,
+ *                                   13 = double LDL^t of indefinite matrices.
+ *                                   Block size for the Cholesky decomposition, 0 = automatic (default).
+ *                                   Number of threads for the Cholesky decomposition, default 1.
+ *                                   Huge pages: 1 = ask for transparent huge pages for the matrices, default 0.
  */
 int main(int argc, char const* const* const argv)
 {
    try
    {
-      if (argc > 3)
+      if (argc == 4 and string(argv[2]) == "factor")
+         factor_file_test(argv[1], argv[3]);
+      else if (argc > 3)
       {
          int beg  = stoi(argv[1]);
          int end  = stoi(argv[2]);
          int prec = stoi(argv[3]);
+         int bs   = argc > 4 ? stoi(argv[4]) : 0;
+         int thrd = argc > 5 ? stoi(argv[5]) : 1;
+         int huge = argc > 6 ? stoi(argv[6]) : 0;
       
-         if (beg < 1 or end < beg or prec < 1 or prec > 4)
+         if (beg < 1 or end < beg or prec < 1 or prec > 13 or bs < 0 or thrd < 1 or huge < 0 or huge > 1)
          {
-            cerr << "usage: " << argv[0] << " N-begin N-end Precison[1-4]\n";
+            cerr << "usage: " << argv[0] << " N-begin N-end Precison[1-13] [Blocksize [Threads [HugePages]]]\n";
             return -1;
          }
 
+         // New matrices are spread over the NUMA nodes like the threads that compute with them
+         memory_policy().threads    = static_cast<unsigned>(thrd);
+         memory_policy().huge_pages = huge == 1;
+
          switch(prec) 
          {
          case 1:
-            test<float>      ("Single Precision", beg, end); //lint !e732
+            test<float>      ("Single Precision", beg, end, bs, thrd); //lint !e732
             break;
          case 2: 
-            test<double>     ("Double Precision", beg, end);  //lint !e732
+            test<double>     ("Double Precision", beg, end, bs, thrd);  //lint !e732
             break;
          case 3: 
-            test<long double>("Extended Precision", beg, end); //lint !e732
+            test<long double>("Extended Precision", beg, end, bs, thrd); //lint !e732
             break;
          case 4:
-            test<quad>       ("Quad Precision", beg, end);  //lint !e732
+            test<quad>       ("Quad Precision", beg, end, bs, thrd);  //lint !e732
+            break;
+         case 5:
+            test_mixed<float, double>("Single Precision refined in Double Precision", beg, end, bs, thrd, 1e-14); //lint !e732
+            break;
+         case 6:
+            test_mixed<double, quad> ("Double Precision refined in Quad Precision", beg, end, bs, thrd, quad(1e-30L)); //lint !e732
+            break;
+         case 7:
+            test_ldlt<double>        ("Double Precision LDL^t", beg, end, bs, false); //lint !e732
+            break;
+         case 8:
+            test_pivoted<double>     ("Double Precision Pivoted Cholesky, Rank N/2", beg, end, bs); //lint !e732
+            break;
+         case 9:
+            test_update<double>      ("Double Precision Append, Update, Downdate", beg, end); //lint !e732
+            break;
+         case 10:
+            test<DoubleDouble>       ("Double-Double Precision", beg, end, bs, thrd); //lint !e732
+            break;
+         case 11:
+            test_fixed_sizes<1>      ("Double Precision Fixed Size", beg, end, 10000); //lint !e732
+            break;
+         case 12:
+            test_multi_rhs<double>   ("Double Precision Multiple Right-hand Sides", beg, end, bs, thrd, 8); //lint !e732
+            break;
+         case 13:
+            test_ldlt<double>        ("Double Precision LDL^t, Indefinite", beg, end, bs, true); //lint !e732
             break;
          }
       }
+      else if (argc == 3 and string(argv[2]) == "sparse")
+         sparse_test(argv[1]);
+      else if (argc == 3 and string(argv[2]) == "compare")
+         precision_compare(argv[1]);
+      else if (argc == 3 and string(argv[2]) == "ldlt")
+         ldlt_test(argv[1]);
+      else if (argc == 3)
+      {
+         cerr << "usage: " << argv[0] << " filename.mm [sparse|compare|ldlt|factor factorfile]\n";
+         return -1;
+      }
       else
       {
          Matrix<double> a{ 3, { 1,  2,  3,
@@ -134,7 +777,7 @@ int main(int argc, char const* const* const argv)
          cout << "LL^t=\n" << ll << endl;
          auto const x = l.triangular_solve(b);
          cout << "x= " << x << endl;
-         auto const y = aa * x;
+         vector<double> const y = aa * x;
          cout << "y= " << y << endl;
          cout << "Error max norm= " << setprecision(12) << max_norm(y - b) << endl;
          cout << "Error two norm= " << setprecision(12) << two_norm(y - b) << endl;
@@ -0,0 +1,120 @@
+/**
+ \file      cholesky_update.hpp
+ \brief     Modify a Cholesky factor for rank-one changes and new rows in O(n^2).
+ \author    Thorsten Koch
+ \version   1.0
+ \date      15Dec2022
+
+ Given A = LL^t, the factor of A + vv^t or A - vv^t is obtained by a sequence of
+ n rotations, and the factor of A bordered by a new row and column by one forward
+ substitution. L is the Matrix returned by Matrix::cholesky(), its upper triangle is zero.
+*/
+
+#ifndef CHOLESKY_UPDATE_HPP
+#define CHOLESKY_UPDATE_HPP
+
+#include <vector>
+#include <algorithm>
+#include <exception>
+#include <cassert>
+
+#include "squareroot.hpp"
+#include "matrix.hpp"
+#include "vector_kernels.hpp"
+
+namespace cholesky_update_detail
+{
+   /** Apply the rotations for LL^t + sign vv^t. Rotation k mixes column k of L with v.
+    *  It is computed when row k is reached, the rows below apply the rotations
+    *  0 to i - 1 one after the other, such that L is accessed row by row.
+    */
+   template <typename T>
+   void rank_one(Matrix<T>& l, std::vector<T> x, bool const downdate)
+   {
+      size_t const n = l.size();
+
+      assert(n == x.size());
+
+      std::vector<T> c(n);
+      std::vector<T> s(n);
+
+      for(size_t i = 0; i < n; i++)
+      {
+         T* const l_i = &l(i, 0);
+         T        x_i = x[i];
+
+         for(size_t k = 0; k < i; k++)
+         {
+            if (downdate)
+               l_i[k] = (l_i[k] - s[k] * x_i) / c[k];
+            else
+               l_i[k] = (l_i[k] + s[k] * x_i) / c[k];
+
+            x_i = c[k] * x_i - s[k] * l_i[k];
+         }
+         T const l_ii = l_i[i];
+         T const r2   = downdate ? l_ii * l_ii - x_i * x_i : l_ii * l_ii + x_i * x_i;
+
+         if (not (r2 > T(0.0)))
+            throw std::runtime_error("Rank-one change makes the matrix indefinite");
+
+         T const r = squareroot(r2);
+
+         c[i]   = r / l_ii;
+         s[i]   = x_i / l_ii;
+         l_i[i] = r;
+      }
+   }
+}
+
+
+/** L := the Cholesky factor of LL^t + vv^t.
+ */
+template <typename T>
+void cholesky_update(Matrix<T>& l, std::vector<T> const& v)
+{
+   cholesky_update_detail::rank_one(l, v, false);
+}
+
+
+/** L := the Cholesky factor of LL^t - vv^t.
+ *  Throws if LL^t - vv^t is not positive definite; L is undefined then.
+ */
+template <typename T>
+void cholesky_downdate(Matrix<T>& l, std::vector<T> const& v)
+{
+   cholesky_update_detail::rank_one(l, v, true);
+}
+
+
+/** L := the Cholesky factor of A with an additional last row and column a, where A = LL^t.
+ *  a has n + 1 elements, the last one is the new diagonal element.
+ *  The new row of L is the solution of L l = a, followed by sqrt(a_nn - l^t l).
+ */
+template <typename T>
+void cholesky_append(Matrix<T>& l, std::vector<T> const& a)
+{
+   size_t const n = l.size();
+
+   assert(a.size() == n + 1);
+
+   Matrix<T> grown(n + 1);
+
+   for(size_t i = 0; i < n; i++)
+      std::copy_n(&l(i, 0), i + 1, &grown(i, 0));
+
+   T* const l_n = &grown(n, 0);
+
+   for(size_t i = 0; i < n; i++)
+      l_n[i] = (a[i] - dot_kernel(&grown(i, 0), l_n, i)) / grown(i, i);
+
+   T const d = a[n] - dot_kernel(l_n, l_n, n);
+
+   if (not (d > T(0.0)))
+      throw std::runtime_error("Appended matrix is not positive definite");
+
+   l_n[n] = squareroot(d);
+   l      = std::move(grown);
+}
+
+#endif // !CHOLESKY_UPDATE_HPP
@@ -0,0 +1,8 @@
+% Entry 3 2 underflows and is read as zero
+3 3 6
+1 1 25
+2 1 15
+2 2 18
+3 1 5
+3 2 1e-400
+3 3 11
@@ -0,0 +1,7 @@
+% Error testcase 5 for coverage, the entry overflows
+3 3 5
+1 1 25
+2 1 15
+2 2 1e400
+3 1 5
+3 3 11
@@ -0,0 +1,4 @@
+% The first pivot is zero, but its column is not
+2 2 2
+2 1 1
+2 2 1
@@ -0,0 +1,193 @@
+/**
+ \file      double_double.hpp
+ \brief     Double-double arithmetic, about 106 bits of precision from pairs of doubles.
+ \author    Thorsten Koch
+ \version   1.0
+ \date      15Dec2022
+
+ A value is the unevaluated sum hi + lo with |lo| <= ulp(hi) / 2. The operations use the
+ error-free transformations two_sum and two_prod (with a fused multiply-add), following
+ Hida, Li and Bailey, "Library for double-double and quad-double arithmetic".
+ Everything is done in hardware doubles, which is much faster than the software
+ __float128 of libquadmath, at a slightly smaller precision and the range of double.
+*/
+
+#ifndef DOUBLE_DOUBLE_HPP
+#define DOUBLE_DOUBLE_HPP
+
+#include <cmath>
+#include <limits>
+#include <iostream>
+#include <cassert>
+#include <quadmath.h>
+
+class DoubleDouble
+{
+private:
+   double hi_;
+   double lo_;
+
+   /** The error-free transformations rely on exact IEEE rounding. With -ffast-math the
+    *  compiler may reassociate their error terms and simplify them to zero. Passing the
+    *  intermediate results through an empty asm hides their origin from the optimizer.
+    *  The asm emits no instruction, but it keeps the value in a register and stops the
+    *  compiler from folding and scheduling across it, so it is only used under fast-math.
+    */
+   static double opaque(double x)
+   {
+#ifdef __FAST_MATH__
+#if defined(__x86_64__) || defined(__i386__)
+      asm("" : "+x"(x));
+#else
+      asm("" : "+g"(x));
+#endif
+#endif
+      return x;
+   }
+
+   // s + e = a + b exactly
+   static DoubleDouble two_sum(double const a, double const b)
+   {
+      double const s  = opaque(a + b);
+      double const bb = opaque(s - a);
+      double const ea = opaque(a - opaque(s - bb));
+      double const eb = opaque(b - bb);
+
+      return { s, ea + eb };
+   }
+
+   // Same, but requires |a| >= |b|
+   static DoubleDouble quick_two_sum(double const a, double const b)
+   {
+      double const s = opaque(a + b);
+
+      return { s, b - opaque(s - a) };
+   }
+
+   // p + e = a * b exactly
+   static DoubleDouble two_prod(double const a, double const b)
+   {
+      double const p = opaque(a * b);
+
+      return { p, std::fma(a, b, -p) };
+   }
+
+public:
+   DoubleDouble() = default; // not initialized, like double
+   DoubleDouble(double const hi, double const lo) : hi_(hi), lo_(lo) {};
+   DoubleDouble(double const x) : hi_(x), lo_(0.0) {}; // implicit, such that T x = 0.0 works
+
+   explicit DoubleDouble(long double const x)
+      : hi_(opaque(static_cast<double>(x))), lo_(static_cast<double>(x - static_cast<long double>(hi_))) {};
+   explicit DoubleDouble(__float128 const x)
+      : hi_(opaque(static_cast<double>(x))), lo_(static_cast<double>(x - static_cast<__float128>(hi_))) {};
+
+   double hi() const { return hi_; };
+   double lo() const { return lo_; };
+
+   explicit operator double()      const { return hi_; };
+   explicit operator long double() const { return static_cast<long double>(hi_) + static_cast<long double>(lo_); };
+   explicit operator __float128()  const { return static_cast<__float128>(hi_) + static_cast<__float128>(lo_); };
+
+   DoubleDouble operator-() const { return { -hi_, -lo_ }; };
+
+   friend DoubleDouble operator+(DoubleDouble const& a, DoubleDouble const& b)
+   {
+      DoubleDouble       s = two_sum(a.hi_, b.hi_);
+      DoubleDouble const t = two_sum(a.lo_, b.lo_);
+
+      s.lo_ += t.hi_;
+      s      = quick_two_sum(s.hi_, s.lo_);
+      s.lo_ += t.lo_;
+
+      return quick_two_sum(s.hi_, s.lo_);
+   }
+
+   friend DoubleDouble operator-(DoubleDouble const& a, DoubleDouble const& b)
+   {
+      return a + (-b);
+   }
+
+   friend DoubleDouble operator*(DoubleDouble const& a, DoubleDouble const& b)
+   {
+      DoubleDouble p = two_prod(a.hi_, b.hi_);
+
+      p.lo_ += a.hi_ * b.lo_ + a.lo_ * b.hi_;
+
+      return quick_two_sum(p.hi_, p.lo_);
+   }
+
+   // Long division with three partial quotients
+   friend DoubleDouble operator/(DoubleDouble const& a, DoubleDouble const& b)
+   {
+      double const q1 = a.hi_ / b.hi_;
+      DoubleDouble r  = a - q1 * b;
+      double const q2 = r.hi_ / b.hi_;
+
+      r = r - q2 * b;
+
+      double const q3 = r.hi_ / b.hi_;
+
+      return quick_two_sum(q1, q2) + q3;
+   }
+
+   DoubleDouble& operator+=(DoubleDouble const& b) { return *this = *this + b; };
+   DoubleDouble& operator-=(DoubleDouble const& b) { return *this = *this - b; };
+   DoubleDouble& operator*=(DoubleDouble const& b) { return *this = *this * b; };
+   DoubleDouble& operator/=(DoubleDouble const& b) { return *this = *this / b; };
+
+   friend bool operator==(DoubleDouble const& a, DoubleDouble const& b) { return a.hi_ == b.hi_ and a.lo_ == b.lo_; };
+   friend bool operator!=(DoubleDouble const& a, DoubleDouble const& b) { return not (a == b); };
+   friend bool operator< (DoubleDouble const& a, DoubleDouble const& b) { return a.hi_ < b.hi_ or (a.hi_ == b.hi_ and a.lo_ < b.lo_); };
+   friend bool operator> (DoubleDouble const& a, DoubleDouble const& b) { return b < a; };
+   friend bool operator<=(DoubleDouble const& a, DoubleDouble const& b) { return not (b < a); };
+   friend bool operator>=(DoubleDouble const& a, DoubleDouble const& b) { return not (a < b); };
+};
+
+
+/** One Newton step on the double square root doubles the number of correct bits.
+ */
+inline DoubleDouble squareroot(DoubleDouble const& x)
+{
+   assert(x >= 0.0);
+
+   if (x.hi() == 0.0)
+      return 0.0;
+
+   double const inv = 1.0 / std::sqrt(x.hi());
+   double const ax  = x.hi() * inv;
+
+   return DoubleDouble(ax) + (x - DoubleDouble(ax) * ax).hi() * (inv * 0.5);
+}
+
+
+inline DoubleDouble absval(DoubleDouble const& x)
+{
+   return x.hi() < 0.0 ? -x : x;
+}
+
+
+// Same cheap hack as for __float128
+inline std::ostream& operator<<(std::ostream& os, DoubleDouble const& x)
+{
+   return os << static_cast<long double>(x);
+}
+
+
+namespace std
+{
+   template <>
+   class numeric_limits<DoubleDouble>
+   {
+   public:
+      static constexpr bool is_specialized = true;
+      static constexpr int  digits         = 2 * numeric_limits<double>::digits; // 106
+
+      static DoubleDouble epsilon() { return 0x1p-104; };
+      static DoubleDouble min()     { return numeric_limits<double>::min(); };
+      static DoubleDouble max()     { return numeric_limits<double>::max(); };
+      static DoubleDouble lowest()  { return numeric_limits<double>::lowest(); };
+   };
+}
+
+#endif // !DOUBLE_DOUBLE_HPP
@@ -0,0 +1,307 @@
+/**
+ \file      fixed_matrix.hpp
+ \brief     Matrices of a size known at compile time, single and batched Cholesky decomposition.
+ \author    Thorsten Koch
+ \version   1.0
+ \date      15Dec2022
+
+ For tiny systems the heap allocation and the loop overhead of Matrix dominate.
+ FixedMatrix keeps its N x N elements in a std::array and all loops have constant
+ bounds, which the compiler unrolls. FixedMatrixBatch factorizes many matrices of the
+ same size at once: the elements are interleaved, element (i,j) of width consecutive
+ matrices forms one SIMD vector, so each operation works on width matrices.
+*/
+
+#ifndef FIXED_MATRIX_HPP
+#define FIXED_MATRIX_HPP
+
+#include <array>
+#include <vector>
+#include <cassert>
+
+#include "squareroot.hpp"
+#include "aligned_allocator.hpp"
+#include "kernels.hpp"
+
+template <typename T, size_t N>
+class FixedMatrix
+{
+private:
+   std::array<T, N * N> value_; //< a(i,j) = value_[i * N + j]
+
+public:
+   FixedMatrix() : value_{} {};
+   explicit FixedMatrix(std::array<T, N * N> const& a) : value_(a) {};
+
+   T&       operator()(size_t r, size_t c)       { assert(r < N and c < N); return value_[r * N + c]; };
+   T const& operator()(size_t r, size_t c) const { assert(r < N and c < N); return value_[r * N + c]; };
+
+   static constexpr size_t size() { return N; };
+
+   FixedMatrix       cholesky() const;
+   std::array<T, N>  triangular_solve(std::array<T, N> const& b) const;
+};
+
+
+/** Cholesky decomposition A = LL^t, only the lower triangle of A is used.
+ */
+template <typename T, size_t N>
+FixedMatrix<T, N> FixedMatrix<T, N>::cholesky() const
+{
+   FixedMatrix l;
+
+#pragma GCC unroll 16
+   for(size_t j = 0; j < N; j++)
+   {
+      T d = value_[j * N + j];
+
+#pragma GCC unroll 16
+      for(size_t k = 0; k < j; k++)
+         d -= l.value_[j * N + k] * l.value_[j * N + k];
+
+      T const l_jj = squareroot(d);
+
+      l.value_[j * N + j] = l_jj;
+
+#pragma GCC unroll 16
+      for(size_t i = j + 1; i < N; i++)
+      {
+         T s = value_[i * N + j];
+
+#pragma GCC unroll 16
+         for(size_t k = 0; k < j; k++)
+            s -= l.value_[i * N + k] * l.value_[j * N + k];
+
+         l.value_[i * N + j] = s / l_jj;
+      }
+   }
+   return l;
+}
+
+
+/** Solve LL^t x = b, with L the lower triangle.
+ */
+template <typename T, size_t N>
+std::array<T, N> FixedMatrix<T, N>::triangular_solve(std::array<T, N> const& b) const
+{
+   std::array<T, N> x(b);
+
+#pragma GCC unroll 16
+   for(size_t i = 0; i < N; i++)
+   {
+#pragma GCC unroll 16
+      for(size_t k = 0; k < i; k++)
+         x[i] -= value_[i * N + k] * x[k];
+
+      x[i] /= value_[i * N + i];
+   }
+#pragma GCC unroll 16
+   for(size_t r = 0; r < N; r++)
+   {
+      size_t const i = N - 1 - r;
+
+#pragma GCC unroll 16
+      for(size_t k = i + 1; k < N; k++)
+         x[i] -= value_[k * N + i] * x[k];
+
+      x[i] /= value_[i * N + i];
+   }
+   return x;
+}
+
+
+// r = A * x
+template <typename T, size_t N>
+std::array<T, N> operator*(FixedMatrix<T, N> const& a, std::array<T, N> const& x)
+{
+   std::array<T, N> r {};
+
+   for(size_t i = 0; i < N; i++)
+      for(size_t j = 0; j < N; j++)
+         r[i] += a(i, j) * x[j];
+
+   return r;
+}
+
+
+/** Many N x N matrices, stored in groups of width matrices with interleaved elements.
+ *  The group is padded with identity matrices.
+ */
+template <typename T, size_t N>
+class FixedMatrixBatch
+{
+public:
+   using vec = typename SimdTraits<T>::vec;
+
+   static constexpr size_t width = SimdTraits<T>::width;
+
+private:
+   size_t                                  count_;    //< Number of matrices
+   std::vector<vec, AlignedAllocator<vec>> value_;    //< Element (i,j) of group g is value_[g * N * N + i * N + j]
+   std::vector<vec, AlignedAllocator<vec>> inv_diag_; //< 1 / l_ii of group g is inv_diag_[g * N + i], set by cholesky()
+
+   T& lane(size_t k, size_t i, size_t j)
+   {
+      return reinterpret_cast<T*>(&value_[(k / width) * N * N + i * N + j])[k % width];
+   };
+   T const& lane(size_t k, size_t i, size_t j) const
+   {
+      return reinterpret_cast<T const*>(&value_[(k / width) * N * N + i * N + j])[k % width];
+   };
+public:
+   explicit FixedMatrixBatch(size_t count);
+
+   size_t size() const { return count_; };
+
+   void              set(size_t k, FixedMatrix<T, N> const& a);
+   FixedMatrix<T, N> get(size_t k) const;
+
+   void                          cholesky();
+   std::vector<std::array<T, N>> triangular_solve(std::vector<std::array<T, N>> const& bs) const;
+   void                          triangular_solve(std::vector<std::array<T, N>> const& bs, std::vector<std::array<T, N>>& xs) const;
+};
+
+
+template <typename T, size_t N>
+FixedMatrixBatch<T, N>::FixedMatrixBatch(size_t const count)
+   : count_(count), value_((count + width - 1) / width * N * N, vec{} + T(0.0)), inv_diag_((count + width - 1) / width * N, vec{} + T(1.0))
+{
+   for(size_t k = count_; k < (count_ + width - 1) / width * width; k++)
+      for(size_t i = 0; i < N; i++)
+         lane(k, i, i) = 1.0;
+}
+
+
+template <typename T, size_t N>
+void FixedMatrixBatch<T, N>::set(size_t const k, FixedMatrix<T, N> const& a)
+{
+   assert(k < count_);
+
+   for(size_t i = 0; i < N; i++)
+      for(size_t j = 0; j < N; j++)
+         lane(k, i, j) = a(i, j);
+}
+
+
+template <typename T, size_t N>
+FixedMatrix<T, N> FixedMatrixBatch<T, N>::get(size_t const k) const
+{
+   assert(k < count_);
+
+   FixedMatrix<T, N> a;
+
+   for(size_t i = 0; i < N; i++)
+      for(size_t j = 0; j < N; j++)
+         a(i, j) = lane(k, i, j);
+
+   return a;
+}
+
+
+/** Cholesky decomposition A = LL^t of all matrices in place, width matrices at a time.
+ *  Only the lower triangles are used, the upper triangles are left unchanged.
+ *  The inverses of the diagonal are kept, such that triangular_solve() does not divide.
+ */
+template <typename T, size_t N>
+void FixedMatrixBatch<T, N>::cholesky()
+{
+   for(size_t g = 0; g * N * N < value_.size(); g++)
+   {
+      vec* const a   = &value_[g * N * N];
+      vec* const inv = &inv_diag_[g * N];
+
+#pragma GCC unroll 16
+      for(size_t i = 0; i < N; i++)
+      {
+         vec* const a_i = a + i * N;
+
+#pragma GCC unroll 16
+         for(size_t j = 0; j < i; j++)
+         {
+            vec const* const a_j = a + j * N;
+            vec              s   = a_i[j];
+
+#pragma GCC unroll 16
+            for(size_t k = 0; k < j; k++)
+               s -= a_i[k] * a_j[k];
+
+            a_i[j] = s * inv[j];
+         }
+         vec d = a_i[i];
+
+#pragma GCC unroll 16
+         for(size_t k = 0; k < i; k++)
+            d -= a_i[k] * a_i[k];
+
+         SimdTraits<T>::sqrt(d);
+
+         a_i[i] = d;
+         inv[i] = (vec{} + T(1.0)) / d;
+      }
+   }
+}
+
+
+/** Solve LL^t x = b for each factor L in the batch, bs[k] is the right-hand side for matrix k.
+ */
+template <typename T, size_t N>
+std::vector<std::array<T, N>> FixedMatrixBatch<T, N>::triangular_solve(std::vector<std::array<T, N>> const& bs) const
+{
+   std::vector<std::array<T, N>> xs(count_);
+
+   triangular_solve(bs, xs);
+
+   return xs;
+}
+
+
+/** Same, into xs, such that the solutions need no new memory if the batch is solved repeatedly.
+ */
+template <typename T, size_t N>
+void FixedMatrixBatch<T, N>::triangular_solve(std::vector<std::array<T, N>> const& bs, std::vector<std::array<T, N>>& xs) const
+{
+   assert(bs.size() == count_);
+   assert(xs.size() == count_);
+
+   for(size_t g = 0; g * width < count_; g++)
+   {
+      vec const* const l   = &value_[g * N * N];
+      vec const* const inv = &inv_diag_[g * N];
+      size_t     const m   = std::min(width, count_ - g * width);
+      vec              x[N];
+
+      // Padding lanes solve a zero right-hand side
+      for(size_t i = 0; i < N; i++)
+         x[i] = vec{} + T(0.0);
+
+      for(size_t k = 0; k < m; k++)
+         for(size_t i = 0; i < N; i++)
+            x[i][k] = bs[g * width + k][i];
+
+#pragma GCC unroll 16
+      for(size_t i = 0; i < N; i++)
+      {
+#pragma GCC unroll 16
+         for(size_t k = 0; k < i; k++)
+            x[i] -= l[i * N + k] * x[k];
+
+         x[i] *= inv[i];
+      }
+#pragma GCC unroll 16
+      for(size_t r = 0; r < N; r++)
+      {
+         size_t const i = N - 1 - r;
+
+#pragma GCC unroll 16
+         for(size_t k = i + 1; k < N; k++)
+            x[i] -= l[k * N + i] * x[k];
+
+         x[i] *= inv[i];
+      }
+      for(size_t k = 0; k < m; k++)
+         for(size_t i = 0; i < N; i++)
+            xs[g * width + k][i] = x[i][k];
+   }
+}
+
+#endif // !FIXED_MATRIX_HPP
@@ -0,0 +1,825 @@
+/**
+ \file      kernels.hpp
+ \brief     Dense block kernels used by the blocked and tiled Cholesky decomposition.
+ \author    Thorsten Koch
+ \version   1.0
+ \date      15Dec2022
+
+ All blocks are stored row-major, a(i,j) = a[i * lda + j].
+*/
+
+#ifndef KERNELS_HPP
+#define KERNELS_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <limits>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+#include <cassert>
+
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+#include "squareroot.hpp"
+#include "threadpool.hpp"
+
+/** Cholesky decomposition of the lower triangle of the n x n block a in place.
+ */
+template <typename T>
+void potrf_kernel(T* const a, size_t const lda, size_t const n)
+{
+   for(size_t i = 0; i < n; i++)
+   {
+      T* const a_i = a + i * lda;
+
+      for(size_t j = 0; j <= i; j++)
+      {
+         T const* const a_j = a + j * lda;
+         T              sum = a_i[j];
+
+         for(size_t k = 0; k < j; k++)
+            sum -= a_i[k] * a_j[k];
+
+         if (i == j)
+            a_i[j] = squareroot(sum);
+         else
+            a_i[j] = sum / a_j[j];
+      }
+   }
+}
+
+
+/** Solve B := B L^-t for the m x n block b, with L the lower triangle of the n x n block l.
+ *  If unit is set, the diagonal of L is taken as one, as for the LDL^t decomposition.
+ */
+template <typename T>
+void trsm_kernel(
+   T const* const l,
+   size_t   const ldl,
+   size_t   const n,
+   T*       const b,
+   size_t   const ldb,
+   size_t   const m,
+   bool     const unit = false)
+{
+   for(size_t i = 0; i < m; i++)
+   {
+      T* const b_i = b + i * ldb;
+
+      for(size_t j = 0; j < n; j++)
+      {
+         T const* const l_j = l + j * ldl;
+         T              sum = b_i[j];
+
+         for(size_t k = 0; k < j; k++)
+            sum -= b_i[k] * l_j[k];
+
+         b_i[j] = unit ? sum : sum / l_j[j];
+      }
+   }
+}
+
+
+/** LDL^t decomposition of the lower triangle of the n x n block a in place.
+ *  The strict lower triangle gets the unit lower triangular L, the diagonal gets D.
+ *  A zero pivot is only allowed if the rest of its column is zero as well.
+ */
+template <typename T>
+void ldlt_kernel(T* const a, size_t const lda, size_t const n)
+{
+   for(size_t j = 0; j < n; j++)
+   {
+      T* const a_j = a + j * lda;
+      T        d   = a_j[j];
+
+      for(size_t k = 0; k < j; k++)
+         d -= a_j[k] * a_j[k] * a[k * lda + k];
+
+      a_j[j] = d;
+
+      for(size_t i = j + 1; i < n; i++)
+      {
+         T* const a_i = a + i * lda;
+         T        sum = a_i[j];
+
+         for(size_t k = 0; k < j; k++)
+            sum -= a_i[k] * a_j[k] * a[k * lda + k];
+
+         if (d != T(0.0))
+            a_i[j] = sum / d;
+         else if (sum == T(0.0))
+            a_i[j] = 0.0;
+         else
+            throw std::runtime_error("Zero pivot in LDL^t decomposition");
+      }
+   }
+}
+
+
+/** Exchange row and column j with row and column p of the symmetric n x n matrix, whose
+ *  lower triangle is stored in a. Columns left of j are part of a factor, only their rows move.
+ */
+template <typename T>
+void symmetric_swap_kernel(T* const a, size_t const lda, size_t const n, size_t j, size_t p)
+{
+   if (j == p)
+      return;
+
+   if (p < j)
+      std::swap(j, p);
+
+   assert(p < n);
+
+   T* const a_j = a + j * lda;
+   T* const a_p = a + p * lda;
+
+   std::swap_ranges(a_j, a_j + j, a_p);
+   std::swap(a_j[j], a_p[p]);
+
+   for(size_t i = j + 1; i < p; i++)
+      std::swap(a[i * lda + j], a_p[i]);
+
+   for(size_t i = p + 1; i < n; i++)
+      std::swap(a[i * lda + j], a[i * lda + p]);
+}
+
+
+/** Update C := C - A B^t for the m x n block c, with a being m x kb and b being n x kb.
+ *  If lower is set, only c(i,j) with j <= i is updated (SYRK, in this case a == b).
+ */
+template <typename T>
+void gemm_nt_kernel(
+   T const* const a,
+   size_t   const lda,
+   T const* const b,
+   size_t   const ldb,
+   size_t   const kb,
+   T*       const c,
+   size_t   const ldc,
+   size_t   const m,
+   size_t   const n,
+   bool     const lower)
+{
+   for(size_t i = 0; i < m; i++)
+   {
+      T const* const a_i  = a + i * lda;
+      T*       const c_i  = c + i * ldc;
+      size_t   const jend = lower ? std::min(n, i + 1) : n;
+      size_t         j    = 0;
+
+      // Four dot products at a time to reuse a_i[k] and keep independent sums
+      for(; j + 4 <= jend; j += 4)
+      {
+         T const* const b_0 = b + (j + 0) * ldb;
+         T const* const b_1 = b + (j + 1) * ldb;
+         T const* const b_2 = b + (j + 2) * ldb;
+         T const* const b_3 = b + (j + 3) * ldb;
+         T s0 = 0.0;
+         T s1 = 0.0;
+         T s2 = 0.0;
+         T s3 = 0.0;
+
+         for(size_t k = 0; k < kb; k++)
+         {
+            T const x = a_i[k];
+
+            s0 += x * b_0[k];
+            s1 += x * b_1[k];
+            s2 += x * b_2[k];
+            s3 += x * b_3[k];
+         }
+         c_i[j + 0] -= s0;
+         c_i[j + 1] -= s1;
+         c_i[j + 2] -= s2;
+         c_i[j + 3] -= s3;
+      }
+      for(; j < jend; j++)
+      {
+         T const* const b_j = b + j * ldb;
+         T              sum = 0.0;
+
+         for(size_t k = 0; k < kb; k++)
+            sum += a_i[k] * b_j[k];
+
+         c_i[j] -= sum;
+      }
+   }
+}
+
+
+/** Tiled Cholesky decomposition LL^t in place.
+ *  The n x n matrix consists of nb x nb tiles, tile(i,j) returns the first element of the
+ *  tile (i,j) with j <= i, whose rows are ldt elements apart.
+ *  The POTRF/TRSM/SYRK/GEMM tile operations of the right-looking algorithm form a task graph,
+ *  each task depending on the last writer of every tile it touches. With more than one
+ *  thread, tasks are released into a work-stealing pool once all their predecessors are done.
+ *  Every tile sees the same operations in the same order as in the serial blocked algorithm.
+ */
+template <typename T, typename Tile_F>
+void potrf_tiled_kernel(
+   size_t   const  n,
+   size_t   const  nb,
+   Tile_F   const& tile,
+   size_t   const  ldt,
+   unsigned const  threads)
+{
+   assert(nb      > 0);
+   assert(threads > 0);
+
+   size_t const tiles = (n + nb - 1) / nb;
+
+   auto tile_index = [](size_t i, size_t j) { assert(j <= i); return i * (i + 1) / 2 + j; };
+   auto tile_dim   = [&](size_t i) { return std::min(nb, n - i * nb); };
+
+   enum class Kind { potrf, trsm, syrk, gemm };
+
+   struct TileTask
+   {
+      Kind                kind;
+      size_t              i;
+      size_t              j;
+      size_t              k;
+      int                 dependencies;
+      std::vector<size_t> successors;
+   };
+   constexpr size_t      no_task = std::numeric_limits<size_t>::max();
+   std::vector<TileTask> tasks;
+   std::vector<size_t>   last_writer(tiles * (tiles + 1) / 2, no_task);
+
+   // Build the graph in the order of the serial algorithm
+   auto add_task = [&](Kind kind, size_t i, size_t j, size_t k, std::initializer_list<size_t> reads)
+   {
+      size_t const id    = tasks.size();
+      size_t const write = tile_index(i, j);
+
+      tasks.push_back({ kind, i, j, k, 0, {} });
+
+      std::vector<size_t> predecessors;
+
+      for(size_t t : reads)
+         predecessors.push_back(last_writer[t]);
+
+      predecessors.push_back(last_writer[write]);
+
+      for(size_t p = 0; p < predecessors.size(); p++)
+      {
+         size_t const pred = predecessors[p];
+
+         if (pred != no_task and std::find(predecessors.begin(), predecessors.begin() + static_cast<long>(p), pred) == predecessors.begin() + static_cast<long>(p))
+         {
+            tasks[pred].successors.push_back(id);
+            tasks[id].dependencies++;
+         }
+      }
+      last_writer[write] = id;
+   };
+   for(size_t k = 0; k < tiles; k++)
+   {
+      add_task(Kind::potrf, k, k, k, {});
+
+      for(size_t i = k + 1; i < tiles; i++)
+         add_task(Kind::trsm, i, k, k, { tile_index(k, k) });
+
+      for(size_t i = k + 1; i < tiles; i++)
+      {
+         add_task(Kind::syrk, i, i, k, { tile_index(i, k) });
+
+         for(size_t j = k + 1; j < i; j++)
+            add_task(Kind::gemm, i, j, k, { tile_index(i, k), tile_index(j, k) });
+      }
+   }
+   auto run_task = [&](TileTask const& task)
+   {
+      switch(task.kind)
+      {
+      case Kind::potrf :
+         potrf_kernel<T>(tile(task.k, task.k), ldt, tile_dim(task.k));
+         break;
+      case Kind::trsm :
+         trsm_kernel<T>(tile(task.k, task.k), ldt, tile_dim(task.k), tile(task.i, task.k), ldt, tile_dim(task.i));
+         break;
+      case Kind::syrk :
+         gemm_nt_kernel<T>(tile(task.i, task.k), ldt, tile(task.i, task.k), ldt, tile_dim(task.k),
+            tile(task.i, task.i), ldt, tile_dim(task.i), tile_dim(task.i), true);
+         break;
+      case Kind::gemm :
+         gemm_nt_kernel<T>(tile(task.i, task.k), ldt, tile(task.j, task.k), ldt, tile_dim(task.k),
+            tile(task.i, task.j), ldt, tile_dim(task.i), tile_dim(task.j), false);
+         break;
+      }
+   };
+   if (threads == 1)
+   {
+      // The creation order is a valid topological order
+      for(auto const& task : tasks)
+         run_task(task);
+
+      return;
+   }
+   std::unique_ptr<std::atomic<int>[]> remaining(new std::atomic<int>[tasks.size()]);
+
+   for(size_t t = 0; t < tasks.size(); t++)
+      remaining[t] = tasks[t].dependencies;
+
+   ThreadPool pool(threads);
+
+   std::function<void(size_t)> execute = [&](size_t const id)
+   {
+      run_task(tasks[id]);
+
+      for(size_t succ : tasks[id].successors)
+         if (--remaining[succ] == 0)
+            pool.submit([&execute, succ] { execute(succ); });
+   };
+   for(size_t t = 0; t < tasks.size(); t++)
+      if (tasks[t].dependencies == 0)
+         pool.submit([&execute, t] { execute(t); });
+
+   pool.wait();
+}
+
+
+/** SIMD vector type used by the GEMM micro-kernel.
+ *  float and double use GCC vector extensions, all other types are handled as scalars.
+ *  The vector extensions have no square root, sqrt() takes it in place with the one of the hardware.
+ */
+template <typename T>
+struct SimdTraits
+{
+   using vec = T;
+   static constexpr size_t width = 1;
+
+   static void sqrt(vec& v) { v = squareroot(v); };
+};
+
+template <>
+struct SimdTraits<float>
+{
+   typedef float vec __attribute__((vector_size(32)));
+   static constexpr size_t width = 8;
+
+   static void sqrt(vec& v)
+   {
+#ifdef __AVX__
+      v = _mm256_sqrt_ps(v);
+#else
+      for(size_t k = 0; k < width; k++)
+         v[k] = squareroot(v[k]);
+#endif
+   };
+};
+
+template <>
+struct SimdTraits<double>
+{
+   typedef double vec __attribute__((vector_size(32)));
+   static constexpr size_t width = 4;
+
+   static void sqrt(vec& v)
+   {
+#ifdef __AVX__
+      v = _mm256_sqrt_pd(v);
+#else
+      for(size_t k = 0; k < width; k++)
+         v[k] = squareroot(v[k]);
+#endif
+   };
+};
+
+
+/** Block sizes for the packed GEMM.
+ *  A micro tile is gemm_mr x gemm_nr, the packed blocks of A and B are
+ *  gemm_mc x gemm_kc (L2 cache) and gemm_kc x gemm_nc (L3 cache).
+ */
+template <typename T>
+struct GemmBlocking
+{
+   static constexpr size_t mr = 4;
+   static constexpr size_t nr = 2 * SimdTraits<T>::width;
+   static constexpr size_t kc = 256;
+   static constexpr size_t mc = 96;
+   static constexpr size_t nc = 2048;
+};
+
+
+/** Buffer for a packed mc x kc block of A. There is one per thread and element type,
+ *  allocated at the first use and reused by all GEMMs of the thread.
+ */
+template <typename T>
+T* gemm_packed_a_buffer()
+{
+   static thread_local std::vector<T> buffer(GemmBlocking<T>::mc * GemmBlocking<T>::kc);
+
+   return buffer.data();
+}
+
+
+/** Copy the mc x kc block of A into slivers of mr rows, stored column by column.
+ *  a(i,p) = a[i * a_rs + p * a_cs], this way also A^t can be packed.
+ *  Missing rows at the border are filled with zeros.
+ */
+template <typename T>
+void gemm_pack_a(T const* const a, size_t const a_rs, size_t const a_cs, size_t const mc, size_t const kc, T* packed)
+{
+   constexpr size_t mr = GemmBlocking<T>::mr;
+   
+   for(size_t i = 0; i < mc; i += mr)
+   {
+      size_t const rows = std::min(mr, mc - i);
+      
+      for(size_t p = 0; p < kc; p++)
+      {
+         for(size_t r = 0; r < rows; r++)
+            packed[r] = a[(i + r) * a_rs + p * a_cs];
+         for(size_t r = rows; r < mr; r++)
+            packed[r] = 0.0;
+
+         packed += mr;
+      }
+   }
+}
+
+
+/** Copy the kc x nc block of B into slivers of nr columns, stored row by row.
+ *  b(p,j) = b[p * b_rs + j * b_cs], this way also A^t can be packed.
+ *  Missing columns at the border are filled with zeros.
+ */
+template <typename T>
+void gemm_pack_b(T const* const b, size_t const b_rs, size_t const b_cs, size_t const kc, size_t const nc, T* packed)
+{
+   constexpr size_t nr = GemmBlocking<T>::nr;
+   
+   for(size_t j = 0; j < nc; j += nr)
+   {
+      size_t const cols = std::min(nr, nc - j);
+      
+      for(size_t p = 0; p < kc; p++)
+      {
+         if (b_cs == 1)
+            std::copy_n(b + p * b_rs + j, cols, packed);
+         else
+            for(size_t c = 0; c < cols; c++)
+               packed[c] = b[p * b_rs + (j + c) * b_cs];
+
+         std::fill(packed + cols, packed + nr, T(0.0));
+
+         packed += nr;
+      }
+   }
+}
+
+
+/** Micro-kernel C += A B (or C -= A B) for one mr x nr tile from packed slivers of A and B.
+ *  The accumulators are kept in registers, m x n is the valid part of the tile.
+ */
+template <typename T>
+void gemm_micro_kernel(
+   size_t   const kc,
+   T const*       a,
+   T const*       b,
+   T*       const c,
+   size_t   const ldc,
+   size_t   const m,
+   size_t   const n,
+   bool     const subtract)
+{
+   using vec = typename SimdTraits<T>::vec;
+   
+   constexpr size_t width = SimdTraits<T>::width;
+   constexpr size_t mr    = GemmBlocking<T>::mr;
+   constexpr size_t nr    = GemmBlocking<T>::nr;
+   constexpr size_t nv    = nr / width;
+
+   vec acc[mr][nv];
+
+   for(size_t r = 0; r < mr; r++)
+      for(size_t v = 0; v < nv; v++)
+         acc[r][v] = vec{} + T(0.0);
+   
+   for(size_t p = 0; p < kc; p++)
+   {
+      vec b_v[nv];
+
+      for(size_t v = 0; v < nv; v++)
+         std::memcpy(&b_v[v], b + v * width, sizeof(vec));
+
+      for(size_t r = 0; r < mr; r++)
+      {
+         vec const a_r = vec{} + a[r];
+         
+         for(size_t v = 0; v < nv; v++)
+            acc[r][v] += a_r * b_v[v];
+      }
+      a += mr;
+      b += nr;
+   }
+   T tile[mr][nr];
+
+   std::memcpy(tile, acc, sizeof(tile));
+
+   if (subtract)
+   {
+      for(size_t r = 0; r < m; r++)
+         for(size_t j = 0; j < n; j++)
+            c[r * ldc + j] -= tile[r][j];
+   }
+   else
+   {
+      for(size_t r = 0; r < m; r++)
+         for(size_t j = 0; j < n; j++)
+            c[r * ldc + j] += tile[r][j];
+   }
+}
+
+
+/** C += A B (or C -= A B if subtract is set) for the m x n matrix c, with a being m x k and b being k x n.
+ *  The elements are a(i,p) = a[i * a_rs + p * a_cs] and b(p,j) = b[p * b_rs + j * b_cs],
+ *  so transposed operands can be used without copying.
+ *  Packed and register blocked GEMM in the style of Goto/BLIS. If a thread pool is
+ *  given, the row blocks of each packed panel of B are distributed over the threads.
+ */
+template <typename T>
+void gemm_kernel(
+   size_t      const m,
+   size_t      const n,
+   size_t      const k,
+   T const*    const a,
+   size_t      const a_rs,
+   size_t      const a_cs,
+   T const*    const b,
+   size_t      const b_rs,
+   size_t      const b_cs,
+   T*          const c,
+   size_t      const ldc,
+   bool        const subtract = false,
+   ThreadPool* const pool     = nullptr)
+{
+   using Blocking = GemmBlocking<T>;
+   
+   std::vector<T> packed_b(Blocking::kc * ((std::min(n, Blocking::nc) + Blocking::nr - 1) / Blocking::nr * Blocking::nr));
+
+   // Multiply the packed B panel with the row block of A starting at ic
+   auto macro_kernel = [&](size_t const ic, size_t const jc, size_t const pc, size_t const nc, size_t const kc)
+   {
+      size_t const mc       = std::min(Blocking::mc, m - ic);
+      T*     const packed_a = gemm_packed_a_buffer<T>();
+
+      gemm_pack_a(a + ic * a_rs + pc * a_cs, a_rs, a_cs, mc, kc, packed_a);
+
+      for(size_t jr = 0; jr < nc; jr += Blocking::nr)
+         for(size_t ir = 0; ir < mc; ir += Blocking::mr)
+            gemm_micro_kernel(kc, &packed_a[ir * kc], &packed_b[jr * kc],
+               c + (ic + ir) * ldc + jc + jr, ldc, std::min(Blocking::mr, mc - ir), std::min(Blocking::nr, nc - jr), subtract);
+   };
+   for(size_t jc = 0; jc < n; jc += Blocking::nc)
+   {
+      size_t const nc = std::min(Blocking::nc, n - jc);
+      
+      for(size_t pc = 0; pc < k; pc += Blocking::kc)
+      {
+         size_t const kc = std::min(Blocking::kc, k - pc);
+
+         gemm_pack_b(b + pc * b_rs + jc * b_cs, b_rs, b_cs, kc, nc, packed_b.data());
+
+         for(size_t ic = 0; ic < m; ic += Blocking::mc)
+         {
+            if (pool != nullptr)
+               pool->submit([&macro_kernel, ic, jc, pc, nc, kc] { macro_kernel(ic, jc, pc, nc, kc); });
+            else
+               macro_kernel(ic, jc, pc, nc, kc);
+         }
+         if (pool != nullptr)
+            pool->wait();
+      }
+   }
+}
+
+/** B := A^t for the rows x cols block a and the cols x rows block b.
+ *  Cache oblivious: the longer side is halved until the blocks are small enough
+ *  that both the rows read and the rows written stay in cache (and in the TLB).
+ */
+template <typename T>
+void transpose_kernel(
+   T const* const a,
+   size_t   const lda,
+   size_t   const rows,
+   size_t   const cols,
+   T*       const b,
+   size_t   const ldb)
+{
+   constexpr size_t leaf = 32;
+
+   if (rows <= leaf and cols <= leaf)
+   {
+      // Writing b row by row is faster than reading a row by row
+      for(size_t j = 0; j < cols; j++)
+         for(size_t i = 0; i < rows; i++)
+            b[j * ldb + i] = a[i * lda + j];
+   }
+   else if (rows >= cols)
+   {
+      size_t const h = rows / 2;
+
+      transpose_kernel(a,           lda, h,        cols, b,     ldb);
+      transpose_kernel(a + h * lda, lda, rows - h, cols, b + h, ldb);
+   }
+   else
+   {
+      size_t const h = cols / 2;
+
+      transpose_kernel(a,     lda, rows, h,        b,           ldb);
+      transpose_kernel(a + h, lda, rows, cols - h, b + h * ldb, ldb);
+   }
+}
+
+
+/** Swap the rows x cols block a with the transpose of the cols x rows block b, a(i,j) <-> b(j,i).
+ *  The blocks must not overlap.
+ */
+template <typename T>
+void transpose_swap_kernel(
+   T*     const a,
+   size_t const lda,
+   size_t const rows,
+   size_t const cols,
+   T*     const b,
+   size_t const ldb)
+{
+   constexpr size_t leaf = 32;
+
+   if (rows <= leaf and cols <= leaf)
+   {
+      for(size_t i = 0; i < rows; i++)
+         for(size_t j = 0; j < cols; j++)
+            std::swap(a[i * lda + j], b[j * ldb + i]);
+   }
+   else if (rows >= cols)
+   {
+      size_t const h = rows / 2;
+
+      transpose_swap_kernel(a,           lda, h,        cols, b,     ldb);
+      transpose_swap_kernel(a + h * lda, lda, rows - h, cols, b + h, ldb);
+   }
+   else
+   {
+      size_t const h = cols / 2;
+
+      transpose_swap_kernel(a,     lda, rows, h,        b,           ldb);
+      transpose_swap_kernel(a + h, lda, rows, cols - h, b + h * ldb, ldb);
+   }
+}
+
+
+/** A := A^t in place for the n x n block a.
+ *  The diagonal blocks are transposed recursively, the off-diagonal blocks are swapped.
+ */
+template <typename T>
+void transpose_inplace_kernel(T* const a, size_t const lda, size_t const n)
+{
+   constexpr size_t leaf = 32;
+
+   if (n <= leaf)
+   {
+      for(size_t i = 0; i < n; i++)
+         for(size_t j = 0; j < i; j++)
+            std::swap(a[i * lda + j], a[j * lda + i]);
+
+      return;
+   }
+   size_t const h = n / 2;
+
+   transpose_inplace_kernel(a,               lda, h);
+   transpose_inplace_kernel(a + h * lda + h, lda, n - h);
+   transpose_swap_kernel(a + h, lda, h, n - h, a + h * lda, lda);
+}
+
+
+/** Solve L L^t X = B in place for the n x m block x, with L the lower triangle of the n x n block l.
+ *  The right-hand sides are the columns of x. Both substitutions proceed in row blocks of nb:
+ *  the contribution of the already solved rows is subtracted with the packed GEMM (for the
+ *  backward substitution using L^t in place), then the nb x nb diagonal block is solved.
+ */
+template <typename T>
+void potrs_kernel(
+   T const* const l,
+   size_t   const ldl,
+   size_t   const n,
+   T*       const x,
+   size_t   const ldx,
+   size_t   const m,
+   size_t   const nb)
+{
+   assert(nb > 0);
+
+   // A single right-hand side would fill only one column of the GEMM micro tiles
+   if (m == 1)
+   {
+      for(size_t i = 0; i < n; i++)
+      {
+         T const* const l_i = l + i * ldl;
+         T              s   = x[i * ldx];
+
+         for(size_t k = 0; k < i; k++)
+            s -= l_i[k] * x[k * ldx];
+
+         x[i * ldx] = s / l_i[i];
+      }
+      for(size_t i = n; i-- > 0; )
+      {
+         T const* const l_i = l + i * ldl;
+
+         x[i * ldx] /= l_i[i];
+
+         for(size_t k = 0; k < i; k++)
+            x[k * ldx] -= l_i[k] * x[i * ldx];
+      }
+      return;
+   }
+
+   // Forward: L Y = B
+   for(size_t ib = 0; ib < n; ib += nb)
+   {
+      size_t const ie = std::min(ib + nb, n);
+
+      gemm_kernel(ie - ib, m, ib, l + ib * ldl, ldl, size_t(1), x, ldx, size_t(1), x + ib * ldx, ldx, true);
+      
+      for(size_t i = ib; i < ie; i++)
+      {
+         T const* const l_i = l + i * ldl;
+         T*       const x_i = x + i * ldx;
+
+         for(size_t k = ib; k < i; k++)
+         {
+            T const        l_ik = l_i[k];
+            T const* const x_k  = x + k * ldx;
+
+            for(size_t j = 0; j < m; j++)
+               x_i[j] -= l_ik * x_k[j];
+         }
+         for(size_t j = 0; j < m; j++)
+            x_i[j] /= l_i[i];
+      }
+   }
+   // Backward: L^t X = Y, ib wraps around after the first block
+   for(size_t ib = n == 0 ? 0 : (n - 1) / nb * nb; ib < n; ib -= nb)
+   {
+      size_t const ie = std::min(ib + nb, n);
+
+      gemm_kernel(ie - ib, m, n - ie, l + ie * ldl + ib, size_t(1), ldl, x + ie * ldx, ldx, size_t(1), x + ib * ldx, ldx, true);
+
+      for(size_t i = ie; i-- > ib; )
+      {
+         T const* const l_i = l + i * ldl;
+         T*       const x_i = x + i * ldx;
+
+         for(size_t j = 0; j < m; j++)
+            x_i[j] /= l_i[i];
+
+         for(size_t k = ib; k < i; k++)
+         {
+            T const  l_ik = l_i[k];
+            T* const x_k  = x + k * ldx;
+
+            for(size_t j = 0; j < m; j++)
+               x_k[j] -= l_ik * x_i[j];
+         }
+      }
+   }
+}
+
+
+/** Solve L L^t x = b for all b in bs, with L the lower triangle of the row-major n x n array l.
+ *  The right-hand sides are interleaved row by row and solved together by potrs_kernel,
+ *  such that L is read only once for all of them.
+ */
+template <typename T>
+std::vector<std::vector<T>> potrs(T const* const l, size_t const n, std::vector<std::vector<T>> const& bs, size_t const nb)
+{
+   size_t const   m = bs.size();
+   std::vector<T> x(n * m);
+   
+   for(size_t j = 0; j < m; j++)
+   {
+      assert(n == bs[j].size());
+
+      for(size_t i = 0; i < n; i++)
+         x[i * m + j] = bs[j][i];
+   }
+   potrs_kernel(l, n, n, x.data(), m, m, nb);
+
+   std::vector<std::vector<T>> xs(m, std::vector<T>(n));
+   
+   for(size_t i = 0; i < n; i++)
+      for(size_t j = 0; j < m; j++)
+         xs[j][i] = x[i * m + j];
+
+   return xs;
+}
+
+#endif // !KERNELS_HPP
@@ -0,0 +1,126 @@
+/**
+ \file      ldlt.hpp
+ \brief     LDL^t decomposition for symmetric matrices that need not be positive definite.
+ \author    Thorsten Koch
+ \version   1.0
+ \date      15Dec2022
+
+ A = L D L^t with L unit lower triangular and D diagonal. No square roots are taken,
+ so negative pivots are fine and a pivot of zero only stops the factorization if its
+ column is not zero. Without pivoting a tiny pivot of an indefinite matrix can still
+ spoil the accuracy; for semi-definite matrices use pivoted_cholesky().
+*/
+
+#ifndef LDLT_HPP
+#define LDLT_HPP
+
+#include <vector>
+#include <algorithm>
+#include <exception>
+#include <cassert>
+
+#include "matrix.hpp"
+#include "kernels.hpp"
+
+template <typename T>
+struct LdltFactor
+{
+   Matrix<T>      l; //< Unit lower triangle, the upper triangle is zero
+   std::vector<T> d; //< Diagonal of D
+
+   std::vector<T> solve(std::vector<T> const& b) const;
+};
+
+
+/** Solve L D L^t x = b.
+ */
+template <typename T>
+std::vector<T> LdltFactor<T>::solve(std::vector<T> const& b) const
+{
+   size_t const n = l.size();
+
+   assert(n == b.size());
+
+   std::vector<T> x(b);
+
+   for(size_t i = 0; i < n; i++)
+      x[i] -= dot_kernel(&l(i, 0), x.data(), i);
+
+   for(size_t i = 0; i < n; i++)
+      x[i] = d[i] != T(0.0) ? x[i] / d[i] : T(0.0); // zero columns give a zero component
+
+   for(size_t i = n; i-- > 0; )
+      for(size_t k = i + 1; k < n; k++)
+         x[i] -= l(k, i) * x[k];
+
+   return x;
+}
+
+
+/** Right-looking blocked LDL^t decomposition, using only the lower triangle of A.
+ *  For each panel the diagonal block is decomposed and the rows below give
+ *  W = A_21 L_11^-t, then L_21 = W D_1^-1 and the trailing matrix is updated by
+ *  A_22 -= W L_21^t, the same tiled update as for the Cholesky decomposition.
+ *  \param block_size Block size for the factorization, 0 = choose automatically.
+ */
+template <typename T>
+LdltFactor<T> ldlt(Matrix<T> const& a, size_t block_size = 0)
+{
+   size_t const n = a.size();
+
+   if (block_size == 0)
+      block_size = n >= Matrix<T>::cholesky_blocked_limit ? Matrix<T>::cholesky_block_size : std::max(n, size_t(1));
+
+   LdltFactor<T> f { Matrix<T>(n), std::vector<T>(n) };
+   T* const      l = f.l.data();
+
+   for(size_t i = 0; i < n; i++)
+      std::copy_n(&a(i, 0), i + 1, &l[i * n]);
+
+   std::vector<T> w((n > block_size ? n - block_size : 0) * block_size);
+
+   for(size_t k0 = 0; k0 < n; k0 += block_size)
+   {
+      size_t const k1   = std::min(k0 + block_size, n);
+      size_t const kb   = k1 - k0;
+      T*     const l_kk = &l[k0 * n + k0];
+
+      ldlt_kernel(l_kk, n, kb);
+      trsm_kernel(l_kk, n, kb, l_kk + kb * n, n, n - k1, true);
+
+      for(size_t i = k1; i < n; i++)
+      {
+         for(size_t k = 0; k < kb; k++)
+         {
+            T const d_k = l_kk[k * n + k];
+            T&      l_ik = l[i * n + k0 + k];
+
+            w[(i - k1) * kb + k] = l_ik;
+
+            if (d_k != T(0.0))
+               l_ik /= d_k;
+            else if (l_ik != T(0.0))
+               throw std::runtime_error("Zero pivot in LDL^t decomposition");
+         }
+      }
+      for(size_t ib = k1; ib < n; ib += block_size)
+      {
+         size_t const ie = std::min(ib + block_size, n);
+
+         for(size_t jb = k1; jb <= ib; jb += block_size)
+         {
+            size_t const je = std::min(jb + block_size, n);
+
+            gemm_nt_kernel(&w[(ib - k1) * kb], kb, &l[jb * n + k0], n, kb, &l[ib * n + jb], n, ie - ib, je - jb, ib == jb);
+         }
+      }
+   }
+   for(size_t i = 0; i < n; i++)
+   {
+      f.d[i]       = l[i * n + i];
+      l[i * n + i] = 1.0;
+   }
+   return f;
+}
+
+#endif // !LDLT_HPP
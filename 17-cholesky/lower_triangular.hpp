@@ -0,0 +1,190 @@
+/**
+ \file      lower_triangular.hpp
+ \brief     Template class for lower triangular matrices in blocked packed storage.
+ \author    Thorsten Koch
+ \version   1.0
+ \date      15Dec2022
+
+ Only the tiles on and below the diagonal are stored. Each tile is a contiguous
+ row-major block_size x block_size array, such that the dense block kernels can work
+ on it directly. For n >> block_size this needs about half the memory of a full Matrix.
+*/
+
+#ifndef LOWER_TRIANGULAR_HPP
+#define LOWER_TRIANGULAR_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+#include "kernels.hpp"
+#include "aligned_allocator.hpp"
+
+template <typename T>
+class Matrix;
+
+template <typename T>
+class LowerTriangularMatrix
+{
+private:
+   using Storage = std::vector<T, AlignedAllocator<T>>;
+
+   size_t  size_;       //< Size of the square matrix
+   size_t  block_size_; //< Size of the square tiles
+   size_t  tiles_;      //< Number of tile rows
+   Storage value_;      //< Tile (i,j) with j <= i starts at value_[(i * (i + 1) / 2 + j) * block_size_^2]
+
+   static size_t tile_index(size_t ti, size_t tj) { assert(tj <= ti); return ti * (ti + 1) / 2 + tj; };
+
+   T*       tile(size_t ti, size_t tj)       { return &value_[tile_index(ti, tj) * block_size_ * block_size_]; };
+   T const* tile(size_t ti, size_t tj) const { return &value_[tile_index(ti, tj) * block_size_ * block_size_]; };
+   size_t   tile_dim(size_t ti)        const { assert(ti < tiles_); return std::min(block_size_, size_ - ti * block_size_); };
+
+public:
+   LowerTriangularMatrix(size_t n, size_t block_size);
+   LowerTriangularMatrix(Matrix<T> const& a, size_t block_size);
+
+   LowerTriangularMatrix(LowerTriangularMatrix const&)            = default;
+   LowerTriangularMatrix(LowerTriangularMatrix&&)                 = default;
+   LowerTriangularMatrix& operator=(LowerTriangularMatrix const&) = default;
+   LowerTriangularMatrix& operator=(LowerTriangularMatrix&&)      = default;
+   ~LowerTriangularMatrix()                                       = default;
+
+   T& operator()(size_t r, size_t c)
+   {
+      assert(c <= r and r < size_);
+      return tile(r / block_size_, c / block_size_)[r % block_size_ * block_size_ + c % block_size_];
+   };
+   T operator()(size_t r, size_t c) const
+   {
+      assert(r < size_ and c < size_);
+      return c > r ? T(0.0) : tile(r / block_size_, c / block_size_)[r % block_size_ * block_size_ + c % block_size_];
+   };
+
+   size_t size()       const { return size_; };
+   size_t block_size() const { return block_size_; };
+
+   void           factor(unsigned threads = 1);
+   std::vector<T> triangular_solve(std::vector<T> const& b) const;
+   Matrix<T>      to_matrix() const;
+};
+
+
+template <typename T>
+LowerTriangularMatrix<T>::LowerTriangularMatrix(size_t const n, size_t const block_size)
+   : size_(n), block_size_(std::max(block_size, size_t(1))), tiles_((n + block_size_ - 1) / block_size_),
+     value_(tiles_ * (tiles_ + 1) / 2 * block_size_ * block_size_) // not initialized
+{
+   // One task per tile, like the tiled decomposition
+   first_touch(value_.data(), tiles_ * (tiles_ + 1) / 2, block_size_ * block_size_, memory_policy().threads, size_t(1));
+}
+
+
+/** Copy the lower triangle of a.
+ */
+template <typename T>
+LowerTriangularMatrix<T>::LowerTriangularMatrix(Matrix<T> const& a, size_t const block_size)
+   : LowerTriangularMatrix(a.size(), block_size)
+{
+   size_t const nb = block_size_;
+
+   for(size_t ti = 0; ti < tiles_; ti++)
+      for(size_t tj = 0; tj <= ti; tj++)
+         for(size_t r = 0; r < tile_dim(ti); r++)
+            std::copy_n(&a(ti * nb + r, tj * nb), ti == tj ? r + 1 : tile_dim(tj), tile(ti, tj) + r * nb);
+}
+
+
+/** Expand into a full Matrix with zeros above the diagonal.
+ */
+template <typename T>
+Matrix<T> LowerTriangularMatrix<T>::to_matrix() const
+{
+   size_t const nb = block_size_;
+   Matrix<T>    a(size_);
+
+   for(size_t ti = 0; ti < tiles_; ti++)
+      for(size_t tj = 0; tj <= ti; tj++)
+         for(size_t r = 0; r < tile_dim(ti); r++)
+            std::copy_n(tile(ti, tj) + r * nb, ti == tj ? r + 1 : tile_dim(tj), &a(ti * nb + r, tj * nb));
+
+   return a;
+}
+
+
+/** Tiled Cholesky decomposition LL^t in place.
+ *  Since the tiled algorithm does the same operations in the same order for every
+ *  thread count, the result does not depend on the number of threads.
+ */
+template <typename T>
+void LowerTriangularMatrix<T>::factor(unsigned const threads)
+{
+   potrf_tiled_kernel<T>(size_, block_size_, [this](size_t ti, size_t tj) { return tile(ti, tj); }, block_size_, threads);
+}
+
+
+/** Solve LL^t x = b.
+ *  Both substitutions run tile by tile along the contiguous rows of the tiles.
+ */
+template <typename T>
+std::vector<T> LowerTriangularMatrix<T>::triangular_solve(std::vector<T> const& b) const
+{
+   assert(size_ == b.size());
+
+   size_t const   nb = block_size_;
+   std::vector<T> x(b);
+
+   // Forward: L y = b
+   for(size_t ti = 0; ti < tiles_; ti++)
+   {
+      T* const     x_i  = &x[ti * nb];
+      size_t const rows = tile_dim(ti);
+
+      for(size_t tj = 0; tj < ti; tj++)
+      {
+         T const* const l   = tile(ti, tj);
+         T const* const x_j = &x[tj * nb];
+
+         for(size_t r = 0; r < rows; r++)
+            for(size_t c = 0; c < nb; c++)
+               x_i[r] -= l[r * nb + c] * x_j[c];
+      }
+      T const* const l = tile(ti, ti);
+
+      for(size_t r = 0; r < rows; r++)
+      {
+         for(size_t c = 0; c < r; c++)
+            x_i[r] -= l[r * nb + c] * x_i[c];
+
+         x_i[r] /= l[r * nb + r];
+      }
+   }
+   // Backward: L^t x = y
+   for(size_t ti = tiles_; ti-- > 0; )
+   {
+      T* const     x_i  = &x[ti * nb];
+      size_t const rows = tile_dim(ti);
+      T const*     l    = tile(ti, ti);
+
+      for(size_t r = rows; r-- > 0; )
+      {
+         x_i[r] /= l[r * nb + r];
+
+         for(size_t c = 0; c < r; c++)
+            x_i[c] -= l[r * nb + c] * x_i[r];
+      }
+      for(size_t tj = 0; tj < ti; tj++)
+      {
+         T* const x_j = &x[tj * nb];
+
+         l = tile(ti, tj);
+
+         for(size_t r = 0; r < rows; r++)
+            for(size_t c = 0; c < nb; c++)
+               x_j[c] -= l[r * nb + c] * x_i[r];
+      }
+   }
+   return x;
+}
+
+#endif // !LOWER_TRIANGULAR_HPP
@@ -0,0 +1,72 @@
+/**
+ \file      mapped_file.hpp
+ \brief     Read-only memory mapping of a file.
+ \author    Thorsten Koch
+ \version   1.0
+ \date      15Dec2022
+*/
+
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <string>
+#include <utility>
+#include <stdexcept>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+class MappedFile
+{
+private:
+   void*  data_ = nullptr;
+   size_t size_ = 0;
+
+public:
+   explicit MappedFile(std::string const& filename);
+   MappedFile(MappedFile const&)            = delete;
+   MappedFile& operator=(MappedFile const&) = delete;
+   MappedFile(MappedFile&& m) noexcept : data_(std::exchange(m.data_, nullptr)), size_(std::exchange(m.size_, 0)) {};
+   MappedFile& operator=(MappedFile&& m) noexcept { std::swap(data_, m.data_); std::swap(size_, m.size_); return *this; };
+   ~MappedFile() { if (data_ != nullptr) munmap(data_, size_); };
+
+   char const* data() const { return static_cast<char const*>(data_); };
+   size_t      size() const { return size_; };
+};
+
+
+/** Map the whole file read-only. An empty file gives an empty mapping.
+ */
+inline MappedFile::MappedFile(std::string const& filename)
+{
+   int const fd = open(filename.c_str(), O_RDONLY);
+
+   if (fd < 0)
+      throw std::runtime_error("Cannot open file: " + filename);
+
+   struct stat st;
+
+   if (fstat(fd, &st) != 0 or not S_ISREG(st.st_mode))
+   {
+      close(fd);
+      throw std::runtime_error("Cannot open file: " + filename);
+   }
+   size_ = static_cast<size_t>(st.st_size);
+
+   if (size_ > 0)
+   {
+      data_ = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+
+      if (data_ == MAP_FAILED)
+      {
+         data_ = nullptr;
+         close(fd);
+         throw std::runtime_error("Cannot map file: " + filename);
+      }
+   }
+   close(fd); // The mapping stays valid
+}
+
+#endif // !MAPPED_FILE_HPP
@@ -22,24 +22,49 @@
 #include <cassert>
 
 #include "squareroot.hpp"
+#include "aligned_allocator.hpp"
+#include "matrix_market.hpp"
+#include "kernels.hpp"
+#include "threadpool.hpp"
+#include "lower_triangular.hpp"
+#include "matrix_file.hpp"
+#include "vector_kernels.hpp"
+#include "vector_expression.hpp"
 
 template <typename T>
 class Matrix
 {
 protected:
-   size_t         size_;   //< Size of the suqare matrix
-   std::vector<T> value_;  //< values of the matrix stored as a(i,j) = value_(i * size_ + j).
+   using Storage = std::vector<T, AlignedAllocator<T>>;
+
+   size_t  size_;   //< Size of the suqare matrix
+   Storage value_;  //< values of the matrix stored as a(i,j) = value_(i * size_ + j), 64 byte aligned.
 
    bool     is_valid() const                { return size_ * size_ == value_.size(); }
    T&       value(size_t r, size_t c)       { assert(r < size_ and c < size_); return value_[r * size_ + c]; };
    T const& value(size_t r, size_t c) const { assert(r < size_ and c < size_); return value_[r * size_ + c]; };
 
+   void factor_panel(size_t k0, size_t k1);
+   void update_trailing(size_t k0, size_t k1, size_t block_size);
+   void factor_blocked(size_t block_size);
+   size_t auto_block_size(size_t block_size) const;
+   void allocate(size_t n);
+
 public:
-   Matrix()                                  : size_(0), value_(0)     { assert(is_valid()); };
-   explicit Matrix(size_t n)                 : size_(n), value_(n * n) { assert(is_valid()); };
-   Matrix(size_t n, std::vector<T> const& a) : size_(n), value_(a)     { assert(is_valid()); };
+   Matrix()                                  : size_(0), value_(0)                  { assert(is_valid()); };
+   explicit Matrix(size_t n)                 : size_(0)                             { allocate(n); };
+   Matrix(size_t n, std::vector<T> const& a) : size_(n), value_(a.begin(), a.end()) { assert(is_valid()); };
    Matrix(size_t n, unsigned seed);
 
+   /** Convert from a matrix with another element type.
+    */
+   template <typename U>
+   explicit Matrix(Matrix<U> const& a) : size_(0)
+   {
+      allocate(a.size());
+      std::transform(a.data(), a.data() + a.size() * a.size(), value_.begin(), [](U x) { return static_cast<T>(x); });
+   }
+
    T&       operator()(size_t r, size_t c)       { return value(r, c); };
    T const& operator()(size_t r, size_t c) const { return value(r, c); };
    
@@ -49,17 +74,48 @@ public:
    Matrix& operator=(Matrix&&)      = default;
    ~Matrix()                        = default;
 
-   size_t size() const { return size_; };
+   size_t   size() const { return size_; };
+   T*       data()       { return value_.data(); };
+   T const* data() const { return value_.data(); };
+
+   static constexpr size_t cholesky_block_size    = 64;  //< Default block size for the blocked Cholesky
+   static constexpr size_t cholesky_blocked_limit = 128; //< Matrices of at least this size are factorized blocked
    
-   Matrix cholesky() const;
+   Matrix cholesky(size_t block_size = 0, unsigned threads = 1) const&;
+   Matrix cholesky(size_t block_size = 0, unsigned threads = 1) &&;
+   void   cholesky_inplace(size_t block_size = 0, unsigned threads = 1);
+   LowerTriangularMatrix<T> cholesky_packed(size_t block_size = 0, unsigned threads = 1) const;
    Matrix transpose() const;
+   void   transpose_inplace();
+   Matrix syrk(unsigned threads = 1) const;
    std::vector<T> triangular_solve(std::vector<T> const& b) const;
+   std::vector<std::vector<T>> triangular_solve(std::vector<std::vector<T>> const& bs) const;
+   Matrix triangular_solve(Matrix const& b) const;
    void read(std::string const& filename);
+   void save_binary(std::string const& filename) const;
+   void load_binary(std::string const& filename);
 };
 
+/** Allocate a zero n x n matrix. The first touch is done as set by memory_policy(),
+ *  in blocks of rows like the panels of the blocked Cholesky decomposition.
+ */
+template <typename T>
+void Matrix<T>::allocate(size_t const n)
+{
+   size_ = n;
+   value_ = Storage(n * n); // not initialized
+
+   first_touch(value_.data(), n, n, memory_policy().threads, cholesky_block_size);
+
+   assert(is_valid());
+}
+
+
 template <typename T>
-Matrix<T>::Matrix(size_t n, unsigned seed) : size_(n), value_(n * n)
+Matrix<T>::Matrix(size_t n, unsigned seed) : size_(0)
 {
+   allocate(n);
+
    std::mt19937                      rng(seed);
    std::uniform_real_distribution<float> dist(0.0, 1.0); // distribution in range [0, 1]
 
@@ -71,26 +127,139 @@ Matrix<T>::Matrix(size_t n, unsigned seed) : size_(n), value_(n * n)
 };
 
 
+/** Factorize the columns k0 to k1 - 1 of the lower triangle in place.
+ *  The diagonal block is decomposed and the rows below are solved against it.
+ *  All updates from the columns left of k0 have to be applied already.
+ */
 template <typename T>
-Matrix<T> Matrix<T>::cholesky() const
+void Matrix<T>::factor_panel(size_t const k0, size_t const k1)
 {
-   Matrix l_result(size_);
-      
-   for(size_t i = 0; i < size_; i++)
+   assert(k0 < k1 and k1 <= size_);
+
+   T* const l_kk = &value_[k0 * size_ + k0];
+
+   potrf_kernel(l_kk, size_, k1 - k0);
+   trsm_kernel(l_kk, size_, k1 - k0, l_kk + (k1 - k0) * size_, size_, size_ - k1);
+}
+
+
+/** Subtract the contribution of the factorized columns k0 to k1 - 1 from the trailing matrix.
+ *  The trailing lower triangle is processed in tiles of block_size x block_size,
+ *  such that the two panel slices needed by a tile stay in the cache.
+ */
+template <typename T>
+void Matrix<T>::update_trailing(size_t const k0, size_t const k1, size_t const block_size)
+{
+   for(size_t ib = k1; ib < size_; ib += block_size)
    {
-      for (size_t j = 0; j <= i; j++)
+      size_t const ie = std::min(ib + block_size, size_);
+      
+      for(size_t jb = k1; jb <= ib; jb += block_size)
       {
-         T sum = value(i, j);
-
-         for(size_t k = 0; k < j; k++)
-            sum -= l_result(i, k) * l_result(j, k);
+         size_t const je = std::min(jb + block_size, size_);
 
-         if (i == j)
-            l_result(i, j) = squareroot(sum); 
-         else
-            l_result(i, j) = sum / l_result(j, j);
+         gemm_nt_kernel(&value_[ib * size_ + k0], size_, &value_[jb * size_ + k0], size_, k1 - k0,
+            &value_[ib * size_ + jb], size_, ie - ib, je - jb, ib == jb);
       }
    }
+}
+
+
+/** Right-looking blocked Cholesky decomposition of the lower triangle in place.
+ *  With block_size >= size() this is the textbook algorithm.
+ */
+template <typename T>
+void Matrix<T>::factor_blocked(size_t const block_size)
+{
+   assert(block_size > 0);
+   
+   for(size_t k0 = 0; k0 < size_; k0 += block_size)
+   {
+      size_t const k1 = std::min(k0 + block_size, size_);
+
+      factor_panel(k0, k1);
+      update_trailing(k0, k1, block_size);
+   }
+}
+
+
+/** Block size to use for the Cholesky decomposition, if 0 is requested choose automatically.
+ */
+template <typename T>
+size_t Matrix<T>::auto_block_size(size_t const block_size) const
+{
+   if (block_size > 0)
+      return block_size;
+
+   return size_ >= cholesky_blocked_limit ? cholesky_block_size : std::max(size_, size_t(1));
+}
+
+
+/** Cholesky decomposition A = LL^t in place.
+ *  Only the lower triangle of A is used and overwritten by L, the upper triangle is left unchanged.
+ *  \param block_size Block size for the factorization, 0 = choose automatically.
+ *  \param threads    With more than one thread the tiles are processed task parallel.
+ */
+template <typename T>
+void Matrix<T>::cholesky_inplace(size_t block_size, unsigned const threads)
+{
+   block_size = auto_block_size(block_size);
+   
+   if (threads > 1)
+      potrf_tiled_kernel<T>(size_, block_size,
+         [this, block_size](size_t ti, size_t tj) { return &value_[ti * block_size * size_ + tj * block_size]; },
+         size_, threads);
+   else
+      factor_blocked(block_size);
+}
+
+
+/** Cholesky decomposition A = LL^t.
+ *  Only the lower triangle of A is used. 
+ *  \param block_size Block size for the factorization, 0 = choose automatically.
+ *  \param threads    With more than one thread the tiles are processed task parallel.
+ */
+template <typename T>
+Matrix<T> Matrix<T>::cholesky(size_t const block_size, unsigned const threads) const&
+{
+   Matrix l_result(size_);
+
+   for(size_t i = 0; i < size_; i++)
+      std::copy_n(&value_[i * size_], i + 1, &l_result.value_[i * size_]);
+
+   l_result.cholesky_inplace(block_size, threads);
+   
+   return l_result;
+};
+
+
+/** Cholesky decomposition A = LL^t reusing the storage of A.
+ *  Use as std::move(a).cholesky() if A is not needed anymore.
+ */
+template <typename T>
+Matrix<T> Matrix<T>::cholesky(size_t const block_size, unsigned const threads) &&
+{
+   cholesky_inplace(block_size, threads);
+
+   for(size_t i = 0; i < size_; i++)
+      std::fill_n(&value_[i * size_ + i] + 1, size_ - i - 1, T(0.0));
+   
+   return std::move(*this);
+};
+
+
+/** Cholesky decomposition A = LL^t into blocked packed storage.
+ *  Only the lower triangle of A is used and only the lower triangle of L is stored.
+ *  \param block_size Tile size of the factor, 0 = choose automatically.
+ *  \param threads    Number of threads for the tiled factorization.
+ */
+template <typename T>
+LowerTriangularMatrix<T> Matrix<T>::cholesky_packed(size_t const block_size, unsigned const threads) const
+{
+   LowerTriangularMatrix<T> l_result(*this, auto_block_size(block_size));
+
+   l_result.factor(threads);
+
    return l_result;
 };
 
@@ -100,14 +269,70 @@ Matrix<T> Matrix<T>::transpose() const
 {
    Matrix t(size_);
 
-   for(size_t i = 0; i < size_; i++)
-      for(size_t j = 0; j < size_; j++)
-         t(j, i) = value(i, j);
+   transpose_kernel(value_.data(), size_, size_, size_, t.data(), size_);
 
    return t;
 };
 
 
+template <typename T>
+void Matrix<T>::transpose_inplace()
+{
+   transpose_inplace_kernel(value_.data(), size_, size_);
+};
+
+
+/** A A^t without forming A^t. Only the lower triangle is computed, using the packed GEMM
+ *  with A^t read in place, and then mirrored, which saves about half of the operations.
+ *  The rows are split into blocks, block [ib, ie) needs the columns 0 to ie - 1 only.
+ *  With more than one thread the blocks are tasks, the largest ones submitted first.
+ */
+template <typename T>
+Matrix<T> Matrix<T>::syrk(unsigned const threads) const
+{
+   constexpr size_t nb = 256;
+   
+   size_t const n = size_;
+   Matrix       c(n);
+
+   if (n == 0)
+      return c;
+   
+   auto row_block = [this, &c, n](size_t const ib)
+   {
+      size_t const ie = std::min(ib + nb, n);
+      
+      gemm_kernel(ie - ib, ie, n, value_.data() + ib * n, n, size_t(1), value_.data(), size_t(1), n, c.data() + ib * n, n);
+   };
+   size_t const blocks = (n + nb - 1) / nb;
+
+   if (threads > 1 and blocks > 1)
+   {
+      ThreadPool pool(threads);
+
+      for(size_t b = blocks; b-- > 0; )
+         pool.submit([&row_block, b] { row_block(b * nb); });
+
+      pool.wait();
+   }
+   else
+   {
+      for(size_t b = 0; b < blocks; b++)
+         row_block(b * nb);
+   }
+   // Mirror the lower triangle tile by tile, such that both sides stay in cache
+   constexpr size_t tb = 64;
+   
+   for(size_t ib = 0; ib < n; ib += tb)
+      for(size_t jb = 0; jb <= ib; jb += tb)
+         for(size_t i = ib; i < std::min(ib + tb, n); i++)
+            for(size_t j = jb; j < std::min({ jb + tb, i, n }); j++)
+               c(j, i) = c(i, j);
+
+   return c;
+};
+
+
 template <typename T>
 std::vector<T> Matrix<T>::triangular_solve(std::vector<T> const& b) const
 {
@@ -163,93 +388,99 @@ std::vector<T> Matrix<T>::triangular_solve(std::vector<T> const& b) const
    return x;
 }
 
+/** Solve LL^t x = b for several right-hand sides.
+ *  The right-hand sides are solved together by a blocked TRSM, such that L is read only once for all of them.
+ */
+template <typename T>
+std::vector<std::vector<T>> Matrix<T>::triangular_solve(std::vector<std::vector<T>> const& bs) const
+{
+   return potrs(value_.data(), size_, bs, cholesky_block_size);
+}
+
+
+/** Solve LL^t X = B, the columns of B are the right-hand sides.
+ *  B is already in the row-major layout of potrs_kernel, so it is solved in a copy without rearranging.
+ */
+template <typename T>
+Matrix<T> Matrix<T>::triangular_solve(Matrix const& b) const
+{
+   assert(size_ == b.size());
+
+   Matrix x(b);
+
+   potrs_kernel(value_.data(), size_, size_, x.data(), size_, size_, cholesky_block_size);
+
+   return x;
+}
+
+
 template<typename T>
 void Matrix<T>::read(std::string const& filename)
 {
-   using std::runtime_error, std::to_string;
-      
-   std::ifstream input(filename);
-   bool          head_line = true;
-   size_t        line_no   = 0;
-   std::string   line;
-   int           rows      = 0;
-   int           cols      = 0;
-   int           nnzs      = 0;
-   int           nnz_count = 0;
-
-   if (not input)
-      throw runtime_error("Cannot open file: " + filename);
-         
-   while(getline(input, line))
-   {
-      line_no++;
-
-      std::istringstream iss(line);
-         
-      // Remove commens starting with %
-      if (size_t n = line.find_first_of('%'); n < line.length())
-         line.erase(n); // n is start position for erase 
+   read_matrix_market<T>(filename,
+      [this](size_t n, size_t) { allocate(n); },
+      [this](size_t r, size_t c, T val) { value(r, c) = val; });
+}
 
-      // If we have an empty line, ignore
-      if (std::all_of(line.begin(), line.end(), isspace))
-         continue;
 
-      if (head_line)
-      {
-         head_line = false;
+/** Write the matrix in the binary format of matrix_file.hpp.
+ *  Use MappedMatrix to read it back without copying.
+ */
+template<typename T>
+void Matrix<T>::save_binary(std::string const& filename) const
+{
+   write_matrix_file(filename, size_, value_.data());
+}
 
-         if ((iss >> rows >> cols >> nnzs).fail() or rows < 1 or cols < 1 or nnzs < 1 or rows != cols)
-            throw runtime_error("Headline syntax error line " + to_string(line_no));
 
-         size_ = rows; //lint !e732
-         value_.resize(size_ * size_, 0.0);
-      }
-      else
-      {
-         int row;
-         int col;
-         T   val;
+template<typename T>
+void Matrix<T>::load_binary(std::string const& filename)
+{
+   MappedFile const file(filename);
+   size_t           n      = 0;
+   T const* const   values = check_matrix_file<T>(file, filename, n, true);
 
-         if ((iss >> row >> col >> val).fail() or row < 1 or col < 1 or row > rows or col > cols or ++nnz_count > nnzs)
-            throw runtime_error("Entry syntax error line " + to_string(line_no));
+   size_ = n;
+   value_.assign(values, values + n * n);
 
-         value(row - 1, col - 1) = val; //lint !e732
-      }
-   }
-   if (nnz_count != nnzs)
-      throw runtime_error("Unexpected EOF, " + to_string(nnzs - nnz_count) + " matrix entries missing");
-      
-   std::cout << "Read " << filename << " with " << line_no << " lines "
-             << rows << " rows " << cols << " columns " << nnzs << " nonzeros,\n";
+   assert(is_valid());
 }
 
 
 // C = A * B
 template <typename T>
-Matrix<T> operator*(Matrix<T> const& a, Matrix<T> const& b)
+Matrix<T> multiply(Matrix<T> const& a, Matrix<T> const& b, unsigned const threads = 1)
 {
    assert(a.size() == b.size());
    
    size_t const n = a.size();
 
    Matrix<T> c(n);
+
+   if (n == 0)
+      return c;
    
-   for(size_t i = 0; i < n; i++)
+   if (threads > 1)
    {
-      for(size_t j = 0; j < n; j++)
-      {
-         T sum = 0.0;
-
-         for(size_t k = 0; k < n; k++)
-            sum += a(i, k) * b(k, j);
+      ThreadPool pool(threads);
 
-         c(i, j) = sum;
-      }
+      gemm_kernel(n, n, n, a.data(), n, size_t(1), b.data(), n, size_t(1), c.data(), n, false, &pool);
    }
+   else
+      gemm_kernel(n, n, n, a.data(), n, size_t(1), b.data(), n, size_t(1), c.data(), n);
+
    return c;   
 }
 
 
+// C = A * B
+template <typename T>
+Matrix<T> operator*(Matrix<T> const& a, Matrix<T> const& b)
+{
+   return multiply(a, b);
+}
+
+
 template<typename T>
 std::ostream & operator<<(std::ostream & os, std::vector<T> const& vec)
 {
@@ -278,31 +509,41 @@ std::ostream & operator<<(std::ostream& os, Matrix<T> const& mat)
 }
 
 
-// r = A * x 
 template <typename T>
-std::vector<T> operator*(Matrix<T> const& a, std::vector<T> const& x)
+struct ResidualNorms
 {
-   assert(a.size() == x.size());
+   T max_norm;
+   T two_norm;
+};
+
+
+/** Max norm and two norm of b - A x, without forming A x or the residual vector.
+ */
+template <typename T>
+ResidualNorms<T> residual_norms(Matrix<T> const& a, std::vector<T> const& x, std::vector<T> const& b)
+{
+   assert(a.size() == x.size() and a.size() == b.size());
+
+   T max_r = 0.0;
+   T sum   = 0.0;
 
-   std::vector<T> r(x.size(), 0.0);
-   
    for(size_t i = 0; i < x.size(); i++)
-      for(size_t j = 0; j < x.size(); j++)
-         r[i] += a(i, j)* x[j]; 
+   {
+      T const r_i = b[i] - dot_kernel(&a(i, 0), x.data(), x.size());
+
+      if (T abs_r = absval(r_i); abs_r > max_r)
+         max_r = abs_r;
 
-   return r;   
+      sum += r_i * r_i;
+   }
+   return { max_r, squareroot(sum) };
 }
 
 #if 1 // Which is nicer and easier to understand?
 template <typename T>
 T two_norm(std::vector<T> const& vec)
 {
-   T sum = 0.0;
-   
-   for(auto x : vec)
-      sum += x * x;
-
-   return squareroot(sum);
+   return squareroot(sum_squares_kernel(vec.data(), vec.size()));
 }
 #else
 template <typename T>
@@ -318,13 +559,7 @@ T two_norm(std::vector<T> const& vec)
 template <typename T>
 T max_norm(std::vector<T> const& vec)
 {
-   T max_x = 0.0;
-   
-   for(auto x : vec)
-      if (T abs_x = absval(x); abs_x > max_x)
-         max_x = abs_x;
-
-   return max_x;
+   return max_abs_kernel(vec.data(), vec.size());
 }
 #else
 template <typename T>
@@ -336,18 +571,4 @@ T max_norm(std::vector<T> const& vec)
 #endif
 
 
-// c = a - b
-template <typename T>
-std::vector<T> operator-(std::vector<T> const& a, std::vector<T> const& b)
-{
-   assert(a.size() == b.size());
-
-   std::vector<T> r(a.size(), 0.0);
-   
-   for(size_t i = 0; i < a.size(); ++i)
-      r[i] = a[i] - b[i];
-
-   return r;
-}
-
 #endif // !MATRIX_HPP
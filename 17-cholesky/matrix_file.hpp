@@ -0,0 +1,226 @@
+/**
+ \file      matrix_file.hpp
+ \brief     Binary file format for square matrices, e.g. to keep a Cholesky factor.
+ \author    Thorsten Koch
+ \version   1.0
+ \date      15Dec2022
+
+ The file starts with a MatrixFileHeader of 64 bytes followed by the n x n elements
+ in row-major order as they are in memory. Since the mapping of a file starts at a
+ page boundary, the payload is 64 byte aligned and can be used without copying.
+ The file is only meant to be read on the machine type it was written on.
+*/
+
+#ifndef MATRIX_FILE_HPP
+#define MATRIX_FILE_HPP
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <exception>
+#include <cassert>
+
+#include "mapped_file.hpp"
+#include "kernels.hpp"
+
+template <typename T>
+class Matrix;
+
+struct MatrixFileHeader
+{
+   static constexpr char          magic_id[8]     = { 'C', 'H', 'O', 'L', 'M', 'A', 'T', '\0' };
+   static constexpr std::uint32_t current_version = 1;
+
+   char          magic[8];
+   std::uint32_t version;
+   std::uint32_t element_type;   //< 1 = float, 2 = double, 3 = long double, 4 = quad, as the precision of the test driver
+   std::uint64_t element_size;
+   std::uint64_t size;           //< Number of rows and columns
+   std::uint64_t payload_offset; //< Start of the elements from the beginning of the file
+   std::uint64_t checksum;       //< matrix_file_checksum() of the payload
+   char          reserved[16];
+};
+
+static_assert(sizeof(MatrixFileHeader) == 64);
+
+template <typename T> constexpr std::uint32_t matrix_file_type()              { return 0; }
+template <>           constexpr std::uint32_t matrix_file_type<float>()       { return 1; }
+template <>           constexpr std::uint32_t matrix_file_type<double>()      { return 2; }
+template <>           constexpr std::uint32_t matrix_file_type<long double>() { return 3; }
+template <>           constexpr std::uint32_t matrix_file_type<__float128>()  { return 4; }
+
+
+/** Fletcher like checksum over 64 bit words, fast enough to check each load.
+ */
+inline std::uint64_t matrix_file_checksum(void const* const data, size_t const bytes)
+{
+   auto const*   p = static_cast<unsigned char const*>(data);
+   std::uint64_t a = 0;
+   std::uint64_t b = 0;
+   size_t        i = 0;
+
+   for(; i + sizeof(std::uint64_t) <= bytes; i += sizeof(std::uint64_t))
+   {
+      std::uint64_t w;
+
+      std::memcpy(&w, p + i, sizeof(w));
+      a += w;
+      b += a;
+   }
+   for(; i < bytes; i++)
+   {
+      a += p[i];
+      b += a;
+   }
+   return a ^ (b << 1) ^ (b >> 63);
+}
+
+
+/** Write the n x n row-major array values.
+ */
+template <typename T>
+void write_matrix_file(std::string const& filename, size_t const n, T const* const values)
+{
+   static_assert(matrix_file_type<T>() > 0, "No binary format for this element type");
+
+   MatrixFileHeader head {};
+   size_t const     bytes = n * n * sizeof(T);
+
+   std::memcpy(head.magic, MatrixFileHeader::magic_id, sizeof(head.magic));
+   head.version        = MatrixFileHeader::current_version;
+   head.element_type   = matrix_file_type<T>();
+   head.element_size   = sizeof(T);
+   head.size           = n;
+   head.payload_offset = sizeof(MatrixFileHeader);
+   head.checksum       = matrix_file_checksum(values, bytes);
+
+   std::ofstream output(filename, std::ios::binary | std::ios::trunc);
+
+   if (not output)
+      throw std::runtime_error("Cannot open file: " + filename);
+
+   output.write(reinterpret_cast<char const*>(&head), sizeof(head));
+   output.write(reinterpret_cast<char const*>(values), static_cast<std::streamsize>(bytes));
+
+   if (not output.flush())
+      throw std::runtime_error("Cannot write file: " + filename);
+}
+
+
+/** Check the header and the checksum of a mapped matrix file.
+ *  \return The start of the elements in the mapping, size gets the number of rows.
+ */
+template <typename T>
+T const* check_matrix_file(MappedFile const& file, std::string const& filename, size_t& size, bool const verify)
+{
+   using std::runtime_error;
+
+   MatrixFileHeader head;
+
+   if (file.size() < sizeof(head))
+      throw runtime_error("Not a matrix file: " + filename);
+
+   std::memcpy(&head, file.data(), sizeof(head));
+
+   if (std::memcmp(head.magic, MatrixFileHeader::magic_id, sizeof(head.magic)) != 0)
+      throw runtime_error("Not a matrix file: " + filename);
+
+   if (head.version != MatrixFileHeader::current_version)
+      throw runtime_error("Unsupported matrix file version " + std::to_string(head.version) + ": " + filename);
+
+   if (head.element_type != matrix_file_type<T>() or head.element_size != sizeof(T))
+      throw runtime_error("Wrong element type in matrix file: " + filename);
+
+   if (head.payload_offset < sizeof(head) or head.payload_offset > file.size() or head.payload_offset % alignof(T) != 0
+      or (head.size > 0 and head.size > (file.size() - head.payload_offset) / sizeof(T) / head.size)
+      or head.payload_offset + head.size * head.size * sizeof(T) != file.size())
+      throw runtime_error("Truncated matrix file: " + filename);
+
+   T const* const values = reinterpret_cast<T const*>(file.data() + head.payload_offset);
+
+   if (verify and matrix_file_checksum(values, file.size() - head.payload_offset) != head.checksum)
+      throw runtime_error("Checksum error in matrix file: " + filename);
+
+   size = head.size;
+
+   return values;
+}
+
+
+/** Read-only square matrix that uses the elements of a mapped matrix file in place.
+ *  Meant for a Cholesky factor L, to solve for new right-hand sides without factorizing again.
+ */
+template <typename T>
+class MappedMatrix
+{
+private:
+   MappedFile file_;
+   size_t     size_;
+   T const*   value_; //< Points into the mapping
+
+public:
+   /** \param verify Check the checksum, this reads the whole file once.
+    */
+   explicit MappedMatrix(std::string const& filename, bool verify = true)
+      : file_(filename), size_(0), value_(check_matrix_file<T>(file_, filename, size_, verify)) {};
+
+   T const& operator()(size_t r, size_t c) const { assert(r < size_ and c < size_); return value_[r * size_ + c]; };
+
+   size_t   size() const { return size_; };
+   T const* data() const { return value_; };
+
+   std::vector<T>              triangular_solve(std::vector<T> const& b) const;
+   std::vector<std::vector<T>> triangular_solve(std::vector<std::vector<T>> const& bs) const;
+   Matrix<T>                   triangular_solve(Matrix<T> const& b) const;
+   Matrix<T>                   to_matrix() const;
+};
+
+
+/** Solve LL^t x = b, with L the lower triangle.
+ */
+template <typename T>
+std::vector<T> MappedMatrix<T>::triangular_solve(std::vector<T> const& b) const
+{
+   assert(size_ == b.size());
+
+   std::vector<T> x(b);
+
+   potrs_kernel(value_, size_, size_, x.data(), size_t(1), size_t(1), Matrix<T>::cholesky_block_size);
+
+   return x;
+}
+
+
+/** Solve LL^t x = b for several right-hand sides, with L the lower triangle.
+ */
+template <typename T>
+std::vector<std::vector<T>> MappedMatrix<T>::triangular_solve(std::vector<std::vector<T>> const& bs) const
+{
+   return potrs(value_, size_, bs, Matrix<T>::cholesky_block_size);
+}
+
+
+/** Solve LL^t X = B, the columns of B are the right-hand sides.
+ */
+template <typename T>
+Matrix<T> MappedMatrix<T>::triangular_solve(Matrix<T> const& b) const
+{
+   assert(size_ == b.size());
+
+   Matrix<T> x(b);
+
+   potrs_kernel(value_, size_, size_, x.data(), size_, size_, Matrix<T>::cholesky_block_size);
+
+   return x;
+}
+
+
+template <typename T>
+Matrix<T> MappedMatrix<T>::to_matrix() const
+{
+   return Matrix<T>(size_, std::vector<T>(value_, value_ + size_ * size_));
+}
+
+#endif // !MATRIX_FILE_HPP
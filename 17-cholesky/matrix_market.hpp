@@ -0,0 +1,313 @@
+/**
+ \file      matrix_market.hpp
+ \brief     Reader for square matrices in Matrix Market coordinate format.
+ \author    Thorsten Koch
+ \version   1.1
+ \date      15Dec2022
+
+ The file is mapped into memory. After the head line, the entries are split at line
+ boundaries into chunks, which are parsed in parallel with std::from_chars.
+ The line numbers in the error messages are the same as for a sequential read.
+*/
+
+#ifndef MATRIX_MARKET_HPP
+#define MATRIX_MARKET_HPP
+
+#include <iostream>
+#include <algorithm>
+#include <exception>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cctype>
+#include <cstdlib>
+#include <limits>
+#include <charconv>
+#include <type_traits>
+#include <thread>
+
+#include <quadmath.h>
+
+#include "mapped_file.hpp"
+#include "threadpool.hpp"
+
+namespace matrix_market_detail
+{
+   inline bool is_blank(char c) { return c == ' ' or c == '\t' or c == '\r' or c == '\v' or c == '\f' or c == '\n'; };
+
+   inline char const* skip_blanks(char const* p, char const* end)
+   {
+      while(p < end and is_blank(*p))
+         p++;
+
+      return p;
+   }
+
+   /** Parse an int at p, advancing p. Same as operator>>, leading blanks and a + sign are allowed.
+    */
+   inline bool parse(char const*& p, char const* end, int& val)
+   {
+      p = skip_blanks(p, end);
+
+      if (p < end and *p == '+' and p + 1 < end and *(p + 1) != '-')
+         p++;
+
+      auto const [next, ec] = std::from_chars(p, end, val);
+
+      p = next;
+
+      return ec == std::errc();
+   }
+
+   template <typename T>
+   bool parse(char const*& p, char const* end, T& val)
+   {
+      p = skip_blanks(p, end);
+
+      if (p < end and *p == '+' and p + 1 < end and *(p + 1) != '-')
+         p++;
+
+      if constexpr (std::is_same_v<T, float> or std::is_same_v<T, double> or std::is_same_v<T, long double>)
+      {
+         // operator>> does not accept inf and nan, so neither do we
+         if (char const* q = p < end and *p == '-' ? p + 1 : p; q < end and std::isalpha(static_cast<unsigned char>(*q)))
+            return false;
+
+         char const* const beg = p;
+
+         auto const [next, ec] = std::from_chars(p, end, val);
+
+         p = next;
+
+         // from_chars fails for values that underflow, operator>> reads them as zero or denormal
+         if (ec == std::errc::result_out_of_range)
+         {
+            long double const v = std::strtold(std::string(beg, next).c_str(), nullptr);
+
+            if (v < -std::numeric_limits<T>::max() or v > std::numeric_limits<T>::max())
+               return false;
+
+            val = static_cast<T>(v);
+
+            return true;
+         }
+         return ec == std::errc();
+      }
+      else // __float128 and types that can be constructed from it, like DoubleDouble
+      {
+         char const* const beg = p;
+
+         while(p < end and not is_blank(*p))
+            p++;
+
+         std::string const token(beg, p);
+         char*             tail;
+
+         val = static_cast<T>(strtoflt128(token.c_str(), &tail));
+
+         return not token.empty() and *tail == '\0';
+      }
+   }
+
+   template <typename T>
+   struct Entry
+   {
+      int row;
+      int col;
+      T   val;
+   };
+
+   /** Result of parsing the lines in [begin, end).
+    */
+   template <typename T>
+   struct Chunk
+   {
+      char const*           begin;
+      char const*           end;
+      size_t                lines      = 0; //< Number of lines in the chunk
+      size_t                error_line = 0; //< Line within the chunk of the first syntax error, 0 if none
+      std::vector<Entry<T>> entries;
+   };
+
+   /** Next line [p, eol), returns the start of the following line.
+    */
+   inline char const* next_line(char const* p, char const* end, char const*& eol)
+   {
+      eol = static_cast<char const*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+
+      if (eol == nullptr)
+      {
+         eol = end;
+         return end;
+      }
+      return eol + 1;
+   }
+
+   /** Cut a comment starting with % and return whether something is left.
+    */
+   inline bool strip_line(char const* p, char const*& eol)
+   {
+      if (auto const pct = static_cast<char const*>(std::memchr(p, '%', static_cast<size_t>(eol - p))); pct != nullptr)
+         eol = pct;
+
+      return skip_blanks(p, eol) < eol;
+   }
+
+   template <typename T>
+   void parse_chunk(Chunk<T>& chunk, int const rows, int const cols)
+   {
+      char const* p = chunk.begin;
+
+      chunk.entries.reserve(static_cast<size_t>(chunk.end - chunk.begin) / 16);
+
+      while(p < chunk.end)
+      {
+         char const* eol;
+         char const* const next = next_line(p, chunk.end, eol);
+
+         chunk.lines++;
+
+         if (strip_line(p, eol))
+         {
+            Entry<T> e;
+
+            if (not parse(p, eol, e.row) or not parse(p, eol, e.col) or not parse(p, eol, e.val)
+               or e.row < 1 or e.col < 1 or e.row > rows or e.col > cols)
+            {
+               chunk.error_line = chunk.lines;
+               return;
+            }
+            chunk.entries.push_back(e);
+         }
+         p = next;
+      }
+   }
+
+   /** Line within the chunk of entry number k, needed only for the error message.
+    */
+   template <typename T>
+   size_t entry_line(Chunk<T> const& chunk, size_t k)
+   {
+      char const* p    = chunk.begin;
+      size_t      line = 0;
+
+      for(;;)
+      {
+         char const* eol;
+         char const* const next = next_line(p, chunk.end, eol);
+
+         line++;
+
+         if (strip_line(p, eol) and k-- == 0)
+            return line;
+
+         p = next;
+      }
+   }
+}
+
+/** Read a square matrix in Matrix Market coordinate format.
+ *  \param header  Called as header(size, nonzeros) once the head line is read.
+ *  \param entry   Called as entry(row, col, value) for each entry in file order, row and col start with 0.
+ *  \param threads Number of threads used for parsing, 0 means all hardware threads.
+ */
+template <typename T, typename Header_F, typename Entry_F>
+void read_matrix_market(std::string const& filename, Header_F header, Entry_F entry, unsigned threads = 0)
+{
+   using std::runtime_error, std::to_string;
+   using namespace matrix_market_detail;
+
+   MappedFile const  file(filename);
+   char const*       p         = file.data();
+   char const* const end       = file.data() + file.size();
+   size_t            line_no   = 0;
+   int               rows      = 0;
+   int               cols      = 0;
+   int               nnzs      = 0;
+   size_t            nnz_count = 0;
+
+   // Head line, skipping comments and empty lines
+   while(p < end)
+   {
+      char const* eol;
+      char const* const next = next_line(p, end, eol);
+
+      line_no++;
+
+      if (strip_line(p, eol))
+      {
+         if (not parse(p, eol, rows) or not parse(p, eol, cols) or not parse(p, eol, nnzs)
+            or rows < 1 or cols < 1 or nnzs < 1 or rows != cols)
+            throw runtime_error("Headline syntax error line " + to_string(line_no));
+
+         header(static_cast<size_t>(rows), static_cast<size_t>(nnzs));
+         p = next;
+         break;
+      }
+      p = next;
+   }
+
+   // Entries: split at line boundaries into chunks of at least 1MB
+   size_t const min_chunk = 1 << 20;
+
+   if (threads == 0)
+      threads = std::max(1u, std::thread::hardware_concurrency());
+
+   size_t const chunk_count = std::clamp(static_cast<size_t>(end - p) / min_chunk, size_t(1), size_t(4) * threads);
+   size_t const chunk_size  = static_cast<size_t>(end - p) / chunk_count + 1;
+
+   std::vector<Chunk<T>> chunks;
+
+   while(p < end)
+   {
+      char const* split = p + std::min(chunk_size, static_cast<size_t>(end - p));
+
+      if (split < end)
+      {
+         auto const nl = static_cast<char const*>(std::memchr(split, '\n', static_cast<size_t>(end - split)));
+
+         split = nl == nullptr ? end : nl + 1;
+      }
+      chunks.push_back({ p, split, 0, 0, {} });
+      p = split;
+   }
+
+   if (chunks.size() <= 1 or threads == 1)
+   {
+      for(auto& chunk : chunks)
+         parse_chunk(chunk, rows, cols);
+   }
+   else
+   {
+      ThreadPool pool(std::min(threads, static_cast<unsigned>(chunks.size())));
+
+      for(auto& chunk : chunks)
+         pool.submit([&chunk, rows, cols] { parse_chunk(chunk, rows, cols); });
+
+      pool.wait();
+   }
+
+   // Check in file order, such that the first error is reported
+   for(auto const& chunk : chunks)
+   {
+      if (nnz_count + chunk.entries.size() > static_cast<size_t>(nnzs))
+         throw runtime_error("Entry syntax error line " + to_string(line_no + entry_line(chunk, static_cast<size_t>(nnzs) - nnz_count)));
+
+      if (chunk.error_line > 0)
+         throw runtime_error("Entry syntax error line " + to_string(line_no + chunk.error_line));
+
+      nnz_count += chunk.entries.size();
+      line_no   += chunk.lines;
+   }
+   if (nnz_count != static_cast<size_t>(nnzs))
+      throw runtime_error("Unexpected EOF, " + to_string(static_cast<size_t>(nnzs) - nnz_count) + " matrix entries missing");
+
+   for(auto const& chunk : chunks)
+      for(auto const& e : chunk.entries)
+         entry(static_cast<size_t>(e.row - 1), static_cast<size_t>(e.col - 1), e.val);
+
+   std::cout << "Read " << filename << " with " << line_no << " lines "
+             << rows << " rows " << cols << " columns " << nnzs << " nonzeros,\n";
+}
+
+#endif // !MATRIX_MARKET_HPP
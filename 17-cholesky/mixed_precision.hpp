@@ -0,0 +1,115 @@
+/**
+ \file      mixed_precision.hpp
+ \brief     Mixed precision solver with Cholesky factor and iterative refinement.
+ \author    Thorsten Koch
+ \version   1.0
+ \date      15Dec2022
+
+ A is factorized in the cheap low precision. The solution is then improved by
+ solving for the residual b - Ax, which is computed in the high precision.
+ Each step gains about the accuracy of the factor, as long as A is not too
+ ill-conditioned for the low precision.
+*/
+
+#ifndef MIXED_PRECISION_HPP
+#define MIXED_PRECISION_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+#include "matrix.hpp"
+
+/** Copy a vector into another element type.
+ */
+template <typename To_T, typename From_T>
+std::vector<To_T> convert(std::vector<From_T> const& v)
+{
+   return std::vector<To_T>(v.begin(), v.end());
+}
+
+
+template <typename T>
+struct RefinementResult
+{
+   std::vector<T> x;          //< Solution
+   T              residual;   //< Backward error |b - Ax| / (|A| |x| + |b|) in the max norm
+   size_t         iterations; //< Number of solves with the factor
+   bool           converged;  //< residual <= tolerance has been reached
+};
+
+
+/** Solve Ax = b with the Cholesky factor of A in Low_T, refining x in High_T.
+ *  Stops if the backward error is at most tolerance, after max_iterations solves,
+ *  or if a step does not halve the residual, i.e., the factor is too inaccurate for A.
+ *  A last step that increases the residual is undone, such that x is the best solution found.
+ *  \param block_size Block size for the factorization, 0 = choose automatically.
+ *  \param threads    Number of threads for the factorization.
+ */
+template <typename Low_T, typename High_T>
+RefinementResult<High_T> mixed_precision_solve(
+   Matrix<High_T>      const& a,
+   std::vector<High_T> const& b,
+   High_T              const  tolerance,
+   size_t              const  max_iterations = 30,
+   size_t              const  block_size     = 0,
+   unsigned            const  threads        = 1)
+{
+   assert(a.size() == b.size());
+
+   RefinementResult<High_T> result { std::vector<High_T>(b.size(), 0.0), 1.0, 0, false };
+
+   High_T const b_norm = max_norm(b);
+
+   if (b_norm == 0.0)
+   {
+      result.residual  = 0.0;
+      result.converged = true;
+
+      return result;
+   }
+   High_T a_norm = 0.0;
+
+   for(size_t i = 0; i < a.size(); i++)
+   {
+      High_T row_sum = 0.0;
+
+      for(size_t j = 0; j < a.size(); j++)
+         row_sum += absval(a(i, j));
+
+      a_norm = std::max(a_norm, row_sum);
+   }
+   auto const          l = Matrix<Low_T>(a).cholesky(block_size, threads);
+   std::vector<High_T> r = b;
+
+   while(result.iterations < max_iterations)
+   {
+      auto const          d = l.triangular_solve(convert<Low_T>(r));
+      std::vector<High_T> x = result.x;
+
+      for(size_t i = 0; i < d.size(); i++)
+         x[i] += d[i];
+
+      std::vector<High_T> r_x = b - a * x;
+      result.iterations++;
+
+      High_T const residual = max_norm(r_x) / (a_norm * max_norm(x) + b_norm);
+
+      // A step that makes x worse is not taken
+      if (residual >= result.residual)
+         break;
+
+      bool const stalled = residual > result.residual / 2;
+
+      result.x         = std::move(x);
+      r                = std::move(r_x);
+      result.residual  = residual;
+      result.converged = residual <= tolerance;
+
+      if (result.converged or stalled)
+         break;
+   }
+   return result;
+}
+
+#endif // !MIXED_PRECISION_HPP
@@ -0,0 +1,166 @@
+/**
+ \file      pivoted_cholesky.hpp
+ \brief     Cholesky decomposition with diagonal pivoting for positive semi-definite matrices.
+ \author    Thorsten Koch
+ \version   1.0
+ \date      15Dec2022
+
+ P A P^t = L L^t, in each step the largest remaining diagonal element becomes the
+ pivot. Once it is not above the tolerance, the rest of the matrix is taken as zero,
+ which reveals the numerical rank of A. The algorithm follows LAPACK xPSTRF.
+*/
+
+#ifndef PIVOTED_CHOLESKY_HPP
+#define PIVOTED_CHOLESKY_HPP
+
+#include <vector>
+#include <numeric>
+#include <limits>
+#include <algorithm>
+#include <cassert>
+
+#include "squareroot.hpp"
+#include "matrix.hpp"
+#include "kernels.hpp"
+
+template <typename T>
+struct PivotedCholesky
+{
+   Matrix<T>           l;           //< Lower triangular factor of P A P^t, columns from rank on are zero
+   std::vector<size_t> permutation; //< Row i of P A P^t is row permutation[i] of A
+   size_t              rank;        //< Number of pivots above the tolerance
+
+   std::vector<T> solve(std::vector<T> const& b) const;
+};
+
+
+/** Solve Ax = b for b in the range of A. The components of x that belong to
+ *  the pivots below the tolerance are set to zero (basic solution).
+ */
+template <typename T>
+std::vector<T> PivotedCholesky<T>::solve(std::vector<T> const& b) const
+{
+   size_t const n = l.size();
+
+   assert(n == b.size());
+
+   std::vector<T> y(rank);
+
+   for(size_t i = 0; i < rank; i++)
+      y[i] = (b[permutation[i]] - dot_kernel(&l(i, 0), y.data(), i)) / l(i, i);
+
+   for(size_t i = rank; i-- > 0; )
+   {
+      for(size_t k = i + 1; k < rank; k++)
+         y[i] -= l(k, i) * y[k];
+
+      y[i] /= l(i, i);
+   }
+   std::vector<T> x(n, 0.0);
+
+   for(size_t i = 0; i < rank; i++)
+      x[permutation[i]] = y[i];
+
+   return x;
+}
+
+
+/** Blocked Cholesky decomposition with diagonal pivoting, using only the lower triangle of A.
+ *  Inside a panel the columns are computed left-looking, keeping the diagonal of the
+ *  trailing matrix up to date to choose the pivots. The trailing matrix is updated
+ *  once per panel with the same tiled update as for the unpivoted decomposition.
+ *  \param tolerance  Pivots up to this value count as zero, < 0 means n * epsilon * max diagonal.
+ *  \param block_size Block size for the factorization, 0 = choose automatically.
+ */
+template <typename T>
+PivotedCholesky<T> pivoted_cholesky(Matrix<T> const& a, T tolerance = -1.0, size_t block_size = 0)
+{
+   size_t const n = a.size();
+
+   if (block_size == 0)
+      block_size = n >= Matrix<T>::cholesky_blocked_limit ? Matrix<T>::cholesky_block_size : std::max(n, size_t(1));
+
+   PivotedCholesky<T> f { Matrix<T>(n), std::vector<size_t>(n), n };
+   T* const           l = f.l.data();
+
+   std::iota(f.permutation.begin(), f.permutation.end(), size_t(0));
+
+   for(size_t i = 0; i < n; i++)
+      std::copy_n(&a(i, 0), i + 1, &l[i * n]);
+
+   if (tolerance < T(0.0))
+   {
+      T max_diag = 0.0;
+
+      for(size_t i = 0; i < n; i++)
+         max_diag = std::max(max_diag, l[i * n + i]);
+
+      tolerance = static_cast<T>(n) * std::numeric_limits<T>::epsilon() * max_diag;
+   }
+   std::vector<T> dots(n); // Contribution of the current panel to the diagonal
+
+   for(size_t k0 = 0; k0 < f.rank; k0 += block_size)
+   {
+      size_t const k1 = std::min(k0 + block_size, n);
+
+      std::fill(dots.begin() + static_cast<long>(k0), dots.end(), T(0.0));
+
+      for(size_t j = k0; j < k1; j++)
+      {
+         size_t p    = j;
+         T      best = l[j * n + j] - dots[j];
+
+         for(size_t i = j + 1; i < n; i++)
+         {
+            if (T const d = l[i * n + i] - dots[i]; d > best)
+            {
+               p    = i;
+               best = d;
+            }
+         }
+         if (best <= tolerance)
+         {
+            f.rank = j;
+            break;
+         }
+         symmetric_swap_kernel(l, n, n, j, p);
+         std::swap(dots[j], dots[p]);
+         std::swap(f.permutation[j], f.permutation[p]);
+
+         T const l_jj = squareroot(best);
+
+         l[j * n + j] = l_jj;
+
+         gemm_nt_kernel(&l[(j + 1) * n + k0], n, &l[j * n + k0], n, j - k0, &l[(j + 1) * n + j], n, n - j - 1, size_t(1), false);
+
+         for(size_t i = j + 1; i < n; i++)
+         {
+            T& l_ij = l[i * n + j];
+
+            l_ij    /= l_jj;
+            dots[i] += l_ij * l_ij;
+         }
+      }
+      if (f.rank < n)
+         break;
+
+      for(size_t ib = k1; ib < n; ib += block_size)
+      {
+         size_t const ie = std::min(ib + block_size, n);
+
+         for(size_t jb = k1; jb <= ib; jb += block_size)
+         {
+            size_t const je = std::min(jb + block_size, n);
+
+            gemm_nt_kernel(&l[ib * n + k0], n, &l[jb * n + k0], n, k1 - k0, &l[ib * n + jb], n, ie - ib, je - jb, ib == jb);
+         }
+      }
+   }
+   // Clear the upper triangle and the remaining matrix, which counts as zero
+   for(size_t i = 0; i < n; i++)
+      std::fill(&l[i * n] + (i < f.rank ? i + 1 : f.rank), &l[i * n] + n, T(0.0));
+
+   return f;
+}
+
+#endif // !PIVOTED_CHOLESKY_HPP
@@ -0,0 +1,666 @@
+/**
+ \file      sparse_cholesky.hpp
+ \brief     Supernodal sparse Cholesky (LL^t) decomposition.
+ \author    Thorsten Koch
+ \version   1.0
+ \date      15Dec2022
+
+ The decomposition is done in three steps:
+ 1. A fill reducing ordering is computed by approximate minimum degree on the quotient graph.
+ 2. The symbolic analysis computes the elimination tree, postorders it, counts the nonzeros
+    of each column of L and groups columns with identical structure into supernodes.
+ 3. The numeric factorization is left-looking: each supernode is stored as a dense block,
+    gathers the updates from its descendants and is then factorized by the dense block kernels.
+*/
+
+#ifndef SPARSE_CHOLESKY_HPP
+#define SPARSE_CHOLESKY_HPP
+
+#include <vector>
+#include <queue>
+#include <utility>
+#include <functional>
+#include <algorithm>
+#include <numeric>
+#include <cassert>
+
+#include "sparse_matrix.hpp"
+#include "kernels.hpp"
+
+/** Approximate minimum degree ordering.
+ *  Eliminated variables become elements of the quotient graph, which represent the
+ *  clique formed by their remaining neighbors. The degree of a variable is bounded
+ *  as in AMD by its variable neighbors, the new element, and the parts of its other
+ *  elements not contained in the new element. Elements completely covered by the new
+ *  element are absorbed. Variables with identical adjacency are merged into
+ *  supervariables, which are eliminated together.
+ *  \param vars Symmetric adjacency lists without the diagonal.
+ *  \return perm, with perm[k] the k-th variable to eliminate.
+ */
+inline std::vector<size_t> minimum_degree_ordering(std::vector<std::vector<size_t>> vars)
+{
+   size_t const n    = vars.size();
+   size_t const none = n;
+
+   std::vector<std::vector<size_t>> elems(n);        // Adjacent elements of each variable
+   std::vector<std::vector<size_t>> evars(n);        // Variables of each element
+   std::vector<size_t>              esize(n, 0);     // Number of variables in each element
+   std::vector<size_t>              nv(n, 1);        // Size of each supervariable, 0 if merged into another
+   std::vector<size_t>              member(n, none); // Next variable merged into the same supervariable
+   std::vector<size_t>              degree(n);
+   std::vector<bool>                eliminated(n, false);
+   std::vector<bool>                absorbed(n, false);
+   std::vector<size_t>              mark(n, none);   // mark[v] == p <=> v in L_p
+   std::vector<size_t>              w(n, none);      // |L_e \ L_p| for the elements next to L_p
+   std::vector<size_t>              touched;
+   std::vector<size_t>              hash(n);
+   std::vector<size_t>              candidates;
+   std::vector<size_t>              perm;
+
+   using Entry = std::pair<size_t, size_t>;
+
+   std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+
+   for(size_t i = 0; i < n; i++)
+   {
+      degree[i] = vars[i].size();
+      queue.emplace(degree[i], i);
+   }
+   perm.reserve(n);
+
+   while(perm.size() < n)
+   {
+      // Take the variable of minimum degree, skipping outdated queue entries
+      size_t p;
+
+      for(;;)
+      {
+         auto const [d, i] = queue.top();
+
+         queue.pop();
+
+         if (not eliminated[i] and nv[i] > 0 and d == degree[i])
+         {
+            p = i;
+            break;
+         }
+      }
+      for(size_t v = p; v != none; v = member[v])
+         perm.push_back(v);
+
+      eliminated[p] = true;
+
+      // The new element p consists of all variables reachable from p
+      std::vector<size_t>& lp     = evars[p];
+      size_t               lp_wgt = 0;
+
+      auto add_to_lp = [&](size_t v)
+      {
+         if (not eliminated[v] and nv[v] > 0 and mark[v] != p)
+         {
+            mark[v] = p;
+            lp.push_back(v);
+            lp_wgt += nv[v];
+         }
+      };
+      for(size_t v : vars[p])
+         add_to_lp(v);
+
+      for(size_t e : elems[p])
+      {
+         if (absorbed[e])
+            continue;
+
+         for(size_t v : evars[e])
+            add_to_lp(v);
+
+         absorbed[e] = true;
+         std::vector<size_t>().swap(evars[e]);
+      }
+      std::vector<size_t>().swap(vars[p]);
+      std::vector<size_t>().swap(elems[p]);
+
+      esize[p] = lp_wgt;
+
+      size_t const remaining = n - perm.size();
+
+      // w[e] = |L_e \ L_p|
+      touched.clear();
+
+      for(size_t i : lp)
+      {
+         for(size_t e : elems[i])
+         {
+            if (absorbed[e])
+               continue;
+
+            if (w[e] == none)
+            {
+               w[e] = esize[e];
+               touched.push_back(e);
+            }
+            w[e] -= nv[i];
+         }
+      }
+      // Update the variables of the new element
+      for(size_t i : lp)
+      {
+         size_t ext = 0;
+
+         auto const elem_end = std::remove_if(elems[i].begin(), elems[i].end(), [&](size_t e)
+         {
+            if (not absorbed[e] and w[e] == 0)
+            {
+               absorbed[e] = true;
+               std::vector<size_t>().swap(evars[e]);
+            }
+            return absorbed[e];
+         });
+         elems[i].erase(elem_end, elems[i].end());
+
+         for(size_t e : elems[i])
+            ext += w[e];
+
+         elems[i].push_back(p);
+
+         // Variables in L_p are covered by the element p now
+         auto const var_end = std::remove_if(vars[i].begin(), vars[i].end(),
+            [&](size_t v) { return eliminated[v] or nv[v] == 0 or mark[v] == p; });
+         vars[i].erase(var_end, vars[i].end());
+
+         hash[i] = 0;
+
+         for(size_t v : vars[i])
+         {
+            ext     += nv[v];
+            hash[i] += v;
+         }
+         for(size_t e : elems[i])
+            hash[i] += e;
+
+         degree[i] = std::min(lp_wgt - nv[i] + ext, remaining - nv[i]);
+      }
+      for(size_t e : touched)
+         w[e] = none;
+
+      // Merge indistinguishable variables, they have the same elements and variables as neighbors
+      candidates.assign(lp.begin(), lp.end());
+
+      std::sort(candidates.begin(), candidates.end(), [&](size_t a, size_t b) { return hash[a] < hash[b]; });
+
+      for(size_t c = 0; c < candidates.size(); c++)
+      {
+         size_t const i = candidates[c];
+
+         if (nv[i] == 0)
+            continue;
+
+         for(size_t d = c + 1; d < candidates.size() and hash[candidates[d]] == hash[i]; d++)
+         {
+            size_t const j = candidates[d];
+
+            if (nv[j] == 0 or elems[i].size() != elems[j].size() or vars[i].size() != vars[j].size())
+               continue;
+
+            std::sort(elems[i].begin(), elems[i].end());
+            std::sort(elems[j].begin(), elems[j].end());
+            std::sort(vars[i].begin(), vars[i].end());
+            std::sort(vars[j].begin(), vars[j].end());
+
+            if (elems[i] != elems[j] or vars[i] != vars[j])
+               continue;
+
+            // j joins i, appended to the list of members of i
+            size_t last = i;
+
+            while(member[last] != none)
+               last = member[last];
+
+            member[last] = j;
+            degree[i]   -= nv[j];
+            nv[i]       += nv[j];
+            nv[j]        = 0;
+            std::vector<size_t>().swap(vars[j]);
+            std::vector<size_t>().swap(elems[j]);
+         }
+      }
+      for(size_t i : lp)
+         if (nv[i] > 0)
+            queue.emplace(degree[i], i);
+   }
+   return perm;
+}
+
+
+template <typename T>
+class SparseCholesky
+{
+private:
+   size_t              size_ = 0;
+   std::vector<size_t> perm_;        //< Row/column k of the factor is row/column perm_[k] of A
+   std::vector<size_t> parent_;      //< Elimination tree, size_ for the roots
+   std::vector<size_t> super_start_; //< Columns of supernode s are super_start_[s] to super_start_[s + 1] - 1
+   std::vector<size_t> super_of_;    //< Supernode of each column
+   std::vector<size_t> row_start_;   //< Rows of supernode s are row_index_[row_start_[s]] to row_index_[row_start_[s + 1] - 1]
+   std::vector<size_t> row_index_;   //< Rows of each supernode, ascending, beginning with its own columns
+   std::vector<size_t> value_start_; //< Block of supernode s starts at value_[value_start_[s]]
+   std::vector<T>      value_;       //< Dense row-major blocks (rows x columns) of the supernodes
+
+   size_t super_count()          const { return super_start_.size() - 1; };
+   size_t super_width(size_t s)  const { return super_start_[s + 1] - super_start_[s]; };
+   size_t super_height(size_t s) const { return row_start_[s + 1] - row_start_[s]; };
+
+   std::vector<size_t> inverse_perm() const;
+   void                build_tree(std::vector<std::vector<size_t>> const& adj);
+
+public:
+   SparseCholesky() = default;
+   explicit SparseCholesky(SparseMatrix<T> const& a) { analyze(a); factor(a); };
+
+   size_t size()            const { return size_; };
+   size_t supernodes()      const { return super_count(); };
+   size_t nonzeros()        const;
+
+   void           analyze(SparseMatrix<T> const& a);
+   void           factor(SparseMatrix<T> const& a);
+   std::vector<T> solve(std::vector<T> const& b) const;
+};
+
+
+template <typename T>
+std::vector<size_t> SparseCholesky<T>::inverse_perm() const
+{
+   std::vector<size_t> iperm(size_);
+
+   for(size_t k = 0; k < size_; k++)
+      iperm[perm_[k]] = k;
+
+   return iperm;
+}
+
+
+/** Elimination tree of the permuted matrix (Liu's algorithm with path compression).
+ */
+template <typename T>
+void SparseCholesky<T>::build_tree(std::vector<std::vector<size_t>> const& adj)
+{
+   std::vector<size_t> const iperm = inverse_perm();
+   std::vector<size_t>       ancestor(size_, size_);
+
+   parent_.assign(size_, size_);
+
+   for(size_t k = 0; k < size_; k++)
+   {
+      for(size_t v : adj[perm_[k]])
+      {
+         for(size_t i = iperm[v]; i < k; )
+         {
+            size_t const next = ancestor[i];
+
+            ancestor[i] = k;
+
+            if (next == size_)
+            {
+               parent_[i] = k;
+               break;
+            }
+            i = next;
+         }
+      }
+   }
+}
+
+
+/** Symbolic analysis: ordering, elimination tree, column counts and supernodes.
+ *  Only the pattern of the lower triangle of A is used.
+ */
+template <typename T>
+void SparseCholesky<T>::analyze(SparseMatrix<T> const& a)
+{
+   size_ = a.size();
+
+   std::vector<std::vector<size_t>> adj(size_);
+
+   for(size_t j = 0; j < size_; j++)
+   {
+      for(size_t p = a.col_start()[j]; p < a.col_start()[j + 1]; p++)
+      {
+         if (size_t const i = a.row_index()[p]; i > j)
+         {
+            adj[i].push_back(j);
+            adj[j].push_back(i);
+         }
+      }
+   }
+   perm_ = minimum_degree_ordering(adj);
+
+   build_tree(adj);
+
+   // Postorder the tree, such that the columns of each subtree and each supernode are consecutive
+   {
+      std::vector<size_t> first_child(size_, size_);
+      std::vector<size_t> next_sibling(size_, size_);
+      std::vector<size_t> post;
+      std::vector<size_t> stack;
+
+      for(size_t j = size_; j-- > 0; )
+      {
+         if (parent_[j] != size_)
+         {
+            next_sibling[j]         = first_child[parent_[j]];
+            first_child[parent_[j]] = j;
+         }
+      }
+      post.reserve(size_);
+
+      for(size_t root = 0; root < size_; root++)
+      {
+         if (parent_[root] != size_)
+            continue;
+
+         stack.push_back(root);
+
+         while(not stack.empty())
+         {
+            size_t const j = stack.back();
+
+            if (first_child[j] != size_)
+            {
+               size_t const child = first_child[j];
+
+               first_child[j] = next_sibling[child];
+               stack.push_back(child);
+            }
+            else
+            {
+               post.push_back(j);
+               stack.pop_back();
+            }
+         }
+      }
+      assert(post.size() == size_);
+
+      std::vector<size_t> perm(size_);
+
+      for(size_t k = 0; k < size_; k++)
+         perm[k] = perm_[post[k]];
+
+      perm_.swap(perm);
+   }
+   build_tree(adj);
+
+   std::vector<size_t> const iperm = inverse_perm();
+
+   // Column counts: row k of L is the subtree of the tree spanned by the entries of row k of A
+   std::vector<size_t> col_count(size_, 1);
+   std::vector<size_t> mark(size_, size_);
+
+   for(size_t k = 0; k < size_; k++)
+   {
+      mark[k] = k;
+
+      for(size_t v : adj[perm_[k]])
+         for(size_t i = iperm[v]; i < k and mark[i] != k; i = parent_[i])
+         {
+            col_count[i]++;
+            mark[i] = k;
+         }
+   }
+   // Fundamental supernodes: a column joins its only child if its structure is the child's minus one
+   std::vector<size_t> child_count(size_, 0);
+
+   for(size_t j = 0; j < size_; j++)
+      if (parent_[j] != size_)
+         child_count[parent_[j]]++;
+
+   super_start_.assign(1, 0);
+
+   for(size_t j = 1; j < size_; j++)
+      if (parent_[j - 1] != j or child_count[j] != 1 or col_count[j - 1] != col_count[j] + 1)
+         super_start_.push_back(j);
+
+   if (size_ > 0)
+      super_start_.push_back(size_);
+
+   super_of_.resize(size_);
+   row_start_.assign(super_count() + 1, 0);
+   value_start_.assign(super_count() + 1, 0);
+
+   for(size_t s = 0; s < super_count(); s++)
+   {
+      size_t const height = col_count[super_start_[s]];
+
+      std::fill(&super_of_[super_start_[s]], &super_of_[super_start_[s + 1] - 1] + 1, s);
+
+      row_start_[s + 1]   = row_start_[s]   + height;
+      value_start_[s + 1] = value_start_[s] + height * super_width(s);
+   }
+   // Row structure of each supernode is the one of its first column
+   std::vector<size_t> fill(row_start_.begin(), row_start_.end() - 1);
+
+   row_index_.resize(row_start_.back());
+
+   for(size_t s = 0; s < super_count(); s++)
+      for(size_t j = super_start_[s]; j < super_start_[s + 1]; j++)
+         row_index_[fill[s]++] = j;
+
+   std::fill(mark.begin(), mark.end(), size_);
+
+   for(size_t k = 0; k < size_; k++)
+   {
+      mark[k] = k;
+
+      for(size_t v : adj[perm_[k]])
+         for(size_t i = iperm[v]; i < k and mark[i] != k; i = parent_[i])
+         {
+            mark[i] = k;
+
+            if (size_t const s = super_of_[i]; i == super_start_[s] and k >= super_start_[s + 1])
+               row_index_[fill[s]++] = k;
+         }
+   }
+   for(size_t s = 0; s < super_count(); s++)
+      assert(fill[s] == row_start_[s + 1]);
+
+   value_.clear();
+}
+
+
+/** Number of nonzeros of L.
+ */
+template <typename T>
+size_t SparseCholesky<T>::nonzeros() const
+{
+   size_t count = 0;
+
+   for(size_t s = 0; s < super_count(); s++)
+      count += super_width(s) * (super_width(s) + 1) / 2 + super_width(s) * (super_height(s) - super_width(s));
+
+   return count;
+}
+
+
+/** Left-looking supernodal numeric factorization.
+ *  A has to have the pattern given to analyze(), only its lower triangle is used.
+ *  Each supernode K is kept in the list of the supernode containing its next row not
+ *  yet used, so the updating descendants of a supernode are found without search.
+ */
+template <typename T>
+void SparseCholesky<T>::factor(SparseMatrix<T> const& a)
+{
+   assert(a.size() == size_);
+
+   size_t const        supers = super_count();
+   size_t const        none   = supers;
+   std::vector<size_t> iperm  = inverse_perm();
+
+   // Lower triangle of P A P^t by columns
+   std::vector<size_t> col_start(size_ + 1, 0);
+
+   for(size_t c = 0; c < size_; c++)
+      for(size_t p = a.col_start()[c]; p < a.col_start()[c + 1]; p++)
+         if (a.row_index()[p] >= c)
+            col_start[std::min(iperm[a.row_index()[p]], iperm[c]) + 1]++;
+
+   std::partial_sum(col_start.begin(), col_start.end(), col_start.begin());
+
+   std::vector<size_t> fill(col_start.begin(), col_start.end() - 1);
+   std::vector<size_t> rows(col_start.back());
+   std::vector<T>      vals(col_start.back());
+
+   for(size_t c = 0; c < size_; c++)
+   {
+      for(size_t p = a.col_start()[c]; p < a.col_start()[c + 1]; p++)
+      {
+         if (a.row_index()[p] >= c)
+         {
+            size_t const i   = iperm[a.row_index()[p]];
+            size_t const j   = iperm[c];
+            size_t const pos = fill[std::min(i, j)]++;
+
+            rows[pos] = std::max(i, j);
+            vals[pos] = a.values()[p];
+         }
+      }
+   }
+   value_.assign(value_start_.back(), 0.0);
+
+   std::vector<size_t> map(size_);          // Row -> position within the current supernode
+   std::vector<size_t> head(supers, none);  // Supernodes waiting to update supernode s
+   std::vector<size_t> next_link(supers, none);
+   std::vector<size_t> position(supers, 0); // First row of supernode s not yet used for updates
+   std::vector<T>      update;
+
+   auto link = [&](size_t const k)
+   {
+      size_t const target = super_of_[row_index_[row_start_[k] + position[k]]];
+
+      next_link[k] = head[target];
+      head[target] = k;
+   };
+   for(size_t s = 0; s < supers; s++)
+   {
+      size_t const   f       = super_start_[s];
+      size_t const   l       = super_start_[s + 1];
+      size_t const   w       = l - f;
+      size_t const   m       = super_height(s);
+      size_t const*  s_rows  = &row_index_[row_start_[s]];
+      T*     const   s_block = &value_[value_start_[s]];
+
+      for(size_t r = 0; r < m; r++)
+         map[s_rows[r]] = r;
+
+      for(size_t j = f; j < l; j++)
+         for(size_t p = col_start[j]; p < col_start[j + 1]; p++)
+            s_block[map[rows[p]] * w + j - f] = vals[p];
+
+      // Gather the updates from the descendants
+      for(size_t k = head[s]; k != none; )
+      {
+         size_t const  next   = next_link[k];
+         size_t const  k_w    = super_width(k);
+         size_t const* k_rows = &row_index_[row_start_[k]];
+         size_t const  k_m    = super_height(k);
+         size_t const  p      = position[k];
+         T const*      k_blk  = &value_[value_start_[k] + p * k_w];
+         size_t        q      = p;
+
+         while(q < k_m and k_rows[q] < l)
+            q++;
+
+         size_t const rows_upd = k_m - p;
+         size_t const cols_upd = q - p;
+
+         // update = - L_K(p.., :) L_K(p..q, :)^t
+         update.assign(rows_upd * cols_upd, 0.0);
+         gemm_nt_kernel(k_blk, k_w, k_blk, k_w, k_w, update.data(), cols_upd, rows_upd, cols_upd, false);
+
+         for(size_t r = 0; r < rows_upd; r++)
+         {
+            size_t const row = k_rows[p + r];
+
+            for(size_t c = 0; c < cols_upd and k_rows[p + c] <= row; c++)
+               s_block[map[row] * w + k_rows[p + c] - f] += update[r * cols_upd + c];
+         }
+         position[k] = q;
+
+         if (q < k_m)
+            link(k);
+
+         k = next;
+      }
+      potrf_kernel(s_block, w, w);
+      trsm_kernel(s_block, w, w, s_block + w * w, w, m - w);
+
+      if (m > w)
+      {
+         position[s] = w;
+         link(s);
+      }
+   }
+}
+
+
+/** Solve A x = b with A = P^t L L^t P.
+ */
+template <typename T>
+std::vector<T> SparseCholesky<T>::solve(std::vector<T> const& b) const
+{
+   assert(b.size() == size_);
+   assert(value_.size() == value_start_.back());
+
+   std::vector<T> y(size_);
+
+   for(size_t k = 0; k < size_; k++)
+      y[k] = b[perm_[k]];
+
+   // Forward: L z = y
+   for(size_t s = 0; s < super_count(); s++)
+   {
+      size_t const   f      = super_start_[s];
+      size_t const   w      = super_width(s);
+      size_t const   m      = super_height(s);
+      size_t const*  s_rows = &row_index_[row_start_[s]];
+      T const* const l      = &value_[value_start_[s]];
+
+      for(size_t r = 0; r < w; r++)
+      {
+         for(size_t c = 0; c < r; c++)
+            y[f + r] -= l[r * w + c] * y[f + c];
+
+         y[f + r] /= l[r * w + r];
+      }
+      for(size_t r = w; r < m; r++)
+         for(size_t c = 0; c < w; c++)
+            y[s_rows[r]] -= l[r * w + c] * y[f + c];
+   }
+   // Backward: L^t x = z
+   for(size_t s = super_count(); s-- > 0; )
+   {
+      size_t const   f      = super_start_[s];
+      size_t const   w      = super_width(s);
+      size_t const   m      = super_height(s);
+      size_t const*  s_rows = &row_index_[row_start_[s]];
+      T const* const l      = &value_[value_start_[s]];
+
+      for(size_t r = w; r < m; r++)
+         for(size_t c = 0; c < w; c++)
+            y[f + c] -= l[r * w + c] * y[s_rows[r]];
+
+      for(size_t r = w; r-- > 0; )
+      {
+         y[f + r] /= l[r * w + r];
+
+         for(size_t c = 0; c < r; c++)
+            y[f + c] -= l[r * w + c] * y[f + r];
+      }
+   }
+   std::vector<T> x(size_);
+
+   for(size_t k = 0; k < size_; k++)
+      x[perm_[k]] = y[k];
+
+   return x;
+}
+
+#endif // !SPARSE_CHOLESKY_HPP
@@ -0,0 +1,228 @@
+/**
+ \file      sparse_matrix.hpp
+ \brief     Template class for square sparse matrices in compressed sparse column (CSC) format.
+ \author    Thorsten Koch
+ \version   1.0
+ \date      15Dec2022
+*/
+
+#ifndef SPARSE_MATRIX_HPP
+#define SPARSE_MATRIX_HPP
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <numeric>
+#include <cassert>
+
+#include "matrix_market.hpp"
+
+template <typename T>
+class SparseMatrix
+{
+public:
+   /** Entry (row, col, value) used to build a matrix.
+    */
+   struct Triplet
+   {
+      size_t row;
+      size_t col;
+      T      value;
+   };
+
+private:
+   size_t              size_;      //< Size of the square matrix
+   std::vector<size_t> col_start_; //< Entries of column j are at col_start_[j] to col_start_[j + 1] - 1
+   std::vector<size_t> row_index_; //< Row of each entry, ascending within a column
+   std::vector<T>      value_;     //< Value of each entry
+
+   bool is_valid() const { return col_start_.size() == size_ + 1 and row_index_.size() == value_.size() and col_start_[size_] == value_.size(); };
+
+public:
+   SparseMatrix() : size_(0), col_start_(1, 0) { assert(is_valid()); };
+   SparseMatrix(size_t n, std::vector<Triplet> const& entries);
+
+   SparseMatrix(SparseMatrix const&)            = default;
+   SparseMatrix(SparseMatrix&&)                 = default;
+   SparseMatrix& operator=(SparseMatrix const&) = default;
+   SparseMatrix& operator=(SparseMatrix&&)      = default;
+   ~SparseMatrix()                              = default;
+
+   size_t                     size()      const { return size_; };
+   size_t                     nonzeros()  const { return value_.size(); };
+   std::vector<size_t> const& col_start() const { return col_start_; };
+   std::vector<size_t> const& row_index() const { return row_index_; };
+   std::vector<T>      const& values()    const { return value_; };
+
+   SparseMatrix transpose() const;
+   SparseMatrix multiply_transpose() const;
+   void         read(std::string const& filename);
+};
+
+
+/** Build the matrix from a list of entries. If an entry is given twice, the last one counts.
+ */
+template <typename T>
+SparseMatrix<T>::SparseMatrix(size_t const n, std::vector<Triplet> const& entries)
+   : size_(n), col_start_(n + 1, 0)
+{
+   // Counting sort by column keeps the order of the entries within a column
+   for(auto const& e : entries)
+   {
+      assert(e.row < n and e.col < n);
+      col_start_[e.col + 1]++;
+   }
+   std::partial_sum(col_start_.begin(), col_start_.end(), col_start_.begin());
+
+   std::vector<size_t>  fill(col_start_.begin(), col_start_.end() - 1);
+   std::vector<Triplet> sorted(entries.size());
+
+   for(auto const& e : entries)
+      sorted[fill[e.col]++] = e;
+
+   row_index_.reserve(entries.size());
+   value_.reserve(entries.size());
+
+   size_t beg = 0;
+
+   for(size_t j = 0; j < size_; j++)
+   {
+      size_t const end = col_start_[j + 1];
+
+      std::stable_sort(sorted.begin() + static_cast<long>(beg), sorted.begin() + static_cast<long>(end),
+         [](Triplet const& a, Triplet const& b) { return a.row < b.row; });
+
+      col_start_[j] = row_index_.size();
+
+      for(size_t k = beg; k < end; k++)
+      {
+         if (k + 1 < end and sorted[k + 1].row == sorted[k].row)
+            continue;
+
+         row_index_.push_back(sorted[k].row);
+         value_.push_back(sorted[k].value);
+      }
+      beg = end;
+   }
+   col_start_[size_] = row_index_.size();
+
+   assert(is_valid());
+}
+
+
+template <typename T>
+SparseMatrix<T> SparseMatrix<T>::transpose() const
+{
+   SparseMatrix t;
+
+   t.size_ = size_;
+   t.col_start_.assign(size_ + 1, 0);
+   t.row_index_.resize(nonzeros());
+   t.value_.resize(nonzeros());
+
+   for(size_t r : row_index_)
+      t.col_start_[r + 1]++;
+
+   std::partial_sum(t.col_start_.begin(), t.col_start_.end(), t.col_start_.begin());
+
+   std::vector<size_t> fill(t.col_start_.begin(), t.col_start_.end() - 1);
+
+   // Going through the columns in order gives ascending rows in the transpose
+   for(size_t j = 0; j < size_; j++)
+   {
+      for(size_t k = col_start_[j]; k < col_start_[j + 1]; k++)
+      {
+         size_t const pos = fill[row_index_[k]]++;
+
+         t.row_index_[pos] = j;
+         t.value_[pos]     = value_[k];
+      }
+   }
+   assert(t.is_valid());
+
+   return t;
+}
+
+
+/** C = A A^t.
+ *  Column j of C is the sum of the columns k of A, scaled by A(j,k), collected in a dense accumulator.
+ */
+template <typename T>
+SparseMatrix<T> SparseMatrix<T>::multiply_transpose() const
+{
+   SparseMatrix const  a_t = transpose(); // column j of A^t is row j of A
+   SparseMatrix        c;
+   std::vector<T>      accu(size_, 0.0);
+   std::vector<size_t> marker(size_, size_);
+   std::vector<size_t> pattern;
+
+   c.size_ = size_;
+   c.col_start_.assign(size_ + 1, 0);
+
+   for(size_t j = 0; j < size_; j++)
+   {
+      pattern.clear();
+
+      for(size_t p = a_t.col_start_[j]; p < a_t.col_start_[j + 1]; p++)
+      {
+         size_t const k    = a_t.row_index_[p];
+         T      const a_jk = a_t.value_[p];
+
+         for(size_t q = col_start_[k]; q < col_start_[k + 1]; q++)
+         {
+            size_t const i = row_index_[q];
+
+            if (marker[i] != j)
+            {
+               marker[i] = j;
+               accu[i]   = 0.0;
+               pattern.push_back(i);
+            }
+            accu[i] += value_[q] * a_jk;
+         }
+      }
+      std::sort(pattern.begin(), pattern.end());
+
+      for(size_t i : pattern)
+      {
+         c.row_index_.push_back(i);
+         c.value_.push_back(accu[i]);
+      }
+      c.col_start_[j + 1] = c.row_index_.size();
+   }
+   assert(c.is_valid());
+
+   return c;
+}
+
+
+template<typename T>
+void SparseMatrix<T>::read(std::string const& filename)
+{
+   std::vector<Triplet> entries;
+   size_t               n = 0;
+
+   read_matrix_market<T>(filename,
+      [&](size_t rows, size_t nnzs) { n = rows; entries.reserve(nnzs); },
+      [&](size_t r, size_t c, T val) { entries.push_back({ r, c, val }); });
+
+   *this = SparseMatrix(n, entries);
+}
+
+
+// r = A * x
+template <typename T>
+std::vector<T> operator*(SparseMatrix<T> const& a, std::vector<T> const& x)
+{
+   assert(a.size() == x.size());
+
+   std::vector<T> r(x.size(), 0.0);
+
+   for(size_t j = 0; j < a.size(); j++)
+      for(size_t k = a.col_start()[j]; k < a.col_start()[j + 1]; k++)
+         r[a.row_index()[k]] += a.values()[k] * x[j];
+
+   return r;
+}
+
+#endif // !SPARSE_MATRIX_HPP
@@ -3,7 +3,37 @@
 ./$1 20 40 2
 ./$1 30 50 3
 ./$1 40 60 4
+./$1 10 30 5
+./$1 20 40 6
+./$1 10 30 7
+./$1 10 30 13
+./$1 60 80 13 16
+./$1 20 40 8
+./$1 20 40 8 8
+./$1 1 30 9
+./$1 10 30 10
+./$1 1 17 11
+./$1 1 40 12
+./$1 20 30 12 4 2
+./$1 20 40 2 8
+./$1 20 40 2 8 4
+./$1 520 521 8 0 1 1
+./$1 20 40 2 8 1 2
 ./$1 data/a10.mm
+./$1 data/a6.mm
+./$1 data/a10.mm sparse
+./$1 data/a9.mm compare
+./$1 data/a9.mm sparse
+./$1 data/a3.mm ldlt
+./$1 data/zero_pivot.mm ldlt
+./$1 data/err01.mm sparse
+rm -f a10.chol
+./$1 data/a10.mm factor a10.chol
+./$1 data/a10.mm factor a10.chol
+./$1 data/a9.mm factor a10.chol
+./$1 data/a10.mm factor data/a9.mm
+./$1 data/a9.mm sprase
+rm -f a10.chol
 ./$1
 ./$1 gibtsnich.mm
 ./$1 17 6 56
@@ -0,0 +1,200 @@
+/**
+ \file      threadpool.hpp
+ \brief     Work-stealing thread pool.
+ \author    Thorsten Koch
+ \version   1.0
+ \date      15Dec2022
+
+ Each worker owns a deque of tasks. It takes new work from the back of its own
+ deque and steals from the front of the other deques once it runs dry.
+ Tasks submitted from within a worker go to the deque of that worker.
+*/
+
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <utility>
+#include <cassert>
+
+class ThreadPool
+{
+public:
+   using Task = std::function<void()>;
+
+private:
+   struct Queue
+   {
+      std::mutex       mutex;
+      std::deque<Task> tasks;
+   };
+   std::vector<std::unique_ptr<Queue>> queues_;
+   std::vector<std::thread>            workers_;
+   std::mutex                          mutex_;      //< Protects sleeping, stop_ and error_
+   std::condition_variable             wakeup_;     //< Signalled when tasks arrive or on stop
+   std::condition_variable             done_;       //< Signalled when no tasks are pending anymore
+   std::atomic<size_t>                 queued_  {0}; //< Tasks in the queues
+   std::atomic<size_t>                 pending_ {0}; //< Tasks submitted but not finished
+   std::atomic<size_t>                 next_    {0}; //< Round robin for submits from outside
+   bool                                stop_    = false;
+   std::exception_ptr                  error_;
+
+   static inline thread_local ThreadPool const* current_pool_  = nullptr;
+   static inline thread_local size_t            current_index_ = 0;
+
+   bool pop(size_t index, Task& task);
+   void run(size_t index);
+
+public:
+   explicit ThreadPool(unsigned threads);
+   ThreadPool(ThreadPool const&)            = delete;
+   ThreadPool& operator=(ThreadPool const&) = delete;
+   ~ThreadPool();
+
+   size_t size() const { return workers_.size(); };
+   void   submit(Task task);
+   void   wait();
+};
+
+
+inline ThreadPool::ThreadPool(unsigned const threads)
+{
+   assert(threads > 0);
+
+   for(unsigned i = 0; i < threads; i++)
+      queues_.emplace_back(std::make_unique<Queue>());
+
+   for(unsigned i = 0; i < threads; i++)
+      workers_.emplace_back([this, i] { run(i); });
+}
+
+
+inline ThreadPool::~ThreadPool()
+{
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+   }
+   wakeup_.notify_all();
+
+   for(auto& worker : workers_)
+      worker.join();
+}
+
+
+/** Queue a task. May be called from inside a task.
+ */
+inline void ThreadPool::submit(Task task)
+{
+   size_t const index = current_pool_ == this ? current_index_ : next_++ % queues_.size();
+
+   pending_++;
+   {
+      // queued_ is counted before the task can be popped, else a pop could decrement it below zero
+      std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+      {
+         std::lock_guard<std::mutex> wakeup_lock(mutex_);
+         queued_++;
+      }
+      queues_[index]->tasks.push_back(std::move(task));
+   }
+   wakeup_.notify_one();
+}
+
+
+/** Wait until all submitted tasks, including those they submitted, are finished.
+ *  An exception thrown by a task is rethrown here.
+ */
+inline void ThreadPool::wait()
+{
+   assert(current_pool_ != this);
+
+   std::unique_lock<std::mutex> lock(mutex_);
+
+   done_.wait(lock, [this] { return pending_ == 0; });
+
+   if (error_)
+      std::rethrow_exception(std::exchange(error_, nullptr));
+}
+
+
+/** Take a task from the own queue or steal one from another.
+ */
+inline bool ThreadPool::pop(size_t const index, Task& task)
+{
+   size_t const count = queues_.size();
+
+   for(size_t i = 0; i < count; i++)
+   {
+      Queue& queue = *queues_[(index + i) % count];
+
+      std::lock_guard<std::mutex> lock(queue.mutex);
+
+      if (not queue.tasks.empty())
+      {
+         if (i == 0)
+         {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+         }
+         else
+         {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+         }
+         queued_--;
+
+         return true;
+      }
+   }
+   return false;
+}
+
+
+inline void ThreadPool::run(size_t const index)
+{
+   current_pool_  = this;
+   current_index_ = index;
+
+   for(;;)
+   {
+      Task task;
+
+      if (pop(index, task))
+      {
+         try
+         {
+            task();
+         }
+         catch(...)
+         {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            if (not error_)
+               error_ = std::current_exception();
+         }
+         if (--pending_ == 0)
+         {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_.notify_all();
+         }
+         continue;
+      }
+      std::unique_lock<std::mutex> lock(mutex_);
+
+      wakeup_.wait(lock, [this] { return stop_ or queued_ > 0; });
+
+      if (stop_ and queued_ == 0)
+         return;
+   }
+}
+
+#endif // !THREADPOOL_HPP
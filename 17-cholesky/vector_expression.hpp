@@ -0,0 +1,302 @@
+/**
+ \file      vector_expression.hpp
+ \brief     Expression templates for vector arithmetic.
+ \author    Thorsten Koch
+ \version   1.0
+ \date      15Dec2022
+
+ a - b, a + b, s * a and A * x do not compute anything, they return a small object
+ that knows how to compute element i. The work is done when the expression is
+ assigned to a std::vector, or by max_norm() and two_norm(), which then need a
+ single pass and no temporary vector, e.g. max_norm(b - A * x).
+
+ Vectors and matrices given as lvalues are referenced, temporaries are moved into the
+ expression. So an expression kept in an auto variable is only valid as long as the
+ lvalues it was built from.
+
+ The operators only take vectors of the element types of Matrix, i.e. floating point
+ types and number classes like DoubleDouble, not std::vector<int> and the like.
+*/
+
+#ifndef VECTOR_EXPRESSION_HPP
+#define VECTOR_EXPRESSION_HPP
+
+#include <vector>
+#include <type_traits>
+#include <utility>
+#include <algorithm>
+#include <cassert>
+
+#include "squareroot.hpp"
+#include "vector_kernels.hpp"
+
+template <typename T>
+class Matrix;
+
+/** Base of all expressions. Converts into a std::vector by evaluating every element once.
+ */
+template <typename E>
+class VectorExpression
+{
+public:
+   static constexpr size_t block_size = 512; //< Elements evaluated at once by for_each_block()
+
+   E const& self() const { return static_cast<E const&>(*this); };
+
+   template <typename T>
+   operator std::vector<T>() const
+   {
+      std::vector<T> r(self().size());
+
+      for(size_t i = 0; i < r.size(); i++)
+         r[i] = self()[i];
+
+      return r;
+   }
+
+   /** Call f(values, count) for consecutive blocks of the evaluated elements.
+    *  The blocks are evaluated into a buffer on the stack, such that f can run vectorized kernels on them.
+    */
+   template <typename F>
+   void for_each_block(F f) const
+   {
+      using T = typename E::value_type;
+
+      E const& e = self();
+      T        buffer[block_size];
+
+      for(size_t i = 0; i < e.size(); i += block_size)
+      {
+         size_t const count = std::min(block_size, e.size() - i);
+
+         for(size_t k = 0; k < count; k++)
+            buffer[k] = e[i + k];
+
+         f(static_cast<T const*>(buffer), count);
+      }
+   }
+};
+
+
+/** Leaf referencing a vector.
+ */
+template <typename T>
+class VectorRef : public VectorExpression<VectorRef<T>>
+{
+private:
+   std::vector<T> const& v_;
+
+public:
+   using value_type = T;
+
+   explicit VectorRef(std::vector<T> const& v) : v_(v) {};
+
+   T        operator[](size_t i) const { return v_[i]; };
+   size_t   size()               const { return v_.size(); };
+   T const* data()               const { return v_.data(); };
+};
+
+
+/** Leaf owning a vector that was a temporary.
+ */
+template <typename T>
+class VectorValue : public VectorExpression<VectorValue<T>>
+{
+private:
+   std::vector<T> v_;
+
+public:
+   using value_type = T;
+
+   explicit VectorValue(std::vector<T>&& v) : v_(std::move(v)) {};
+
+   T        operator[](size_t i) const { return v_[i]; };
+   size_t   size()               const { return v_.size(); };
+   T const* data()               const { return v_.data(); };
+};
+
+
+namespace vector_expression_detail
+{
+   template <typename A>
+   struct is_vector : std::false_type {};
+
+   template <typename T>
+   struct is_vector<std::vector<T>> : std::bool_constant<std::is_floating_point_v<T> or std::is_same_v<T, __float128> or (std::is_class_v<T> and std::is_constructible_v<T, double>)> {};
+
+   template <typename A>
+   struct is_matrix : std::false_type {};
+
+   template <typename T>
+   struct is_matrix<Matrix<T>> : std::true_type {};
+
+   template <typename A>
+   constexpr bool is_expression_v = std::is_base_of_v<VectorExpression<std::decay_t<A>>, std::decay_t<A>>;
+
+   template <typename A>
+   constexpr bool is_operand_v = is_vector<std::decay_t<A>>::value or is_expression_v<A>;
+
+   /** How an operand is kept inside an expression.
+    */
+   template <typename A, bool = is_vector<std::decay_t<A>>::value>
+   struct Leaf
+   {
+      using type = std::decay_t<A>; // expressions are copied, they are small
+   };
+
+   template <typename A>
+   struct Leaf<A, true>
+   {
+      using T    = typename std::decay_t<A>::value_type;
+      using type = std::conditional_t<std::is_lvalue_reference_v<A>, VectorRef<T>, VectorValue<T>>;
+   };
+
+   template <typename A>
+   using leaf_t = typename Leaf<A>::type;
+
+   template <typename A>
+   using value_t = typename std::decay_t<A>::value_type;
+
+   /** How a matrix is kept inside a product.
+    */
+   template <typename M>
+   using matrix_leaf_t = std::conditional_t<std::is_lvalue_reference_v<M>, std::decay_t<M> const&, std::decay_t<M>>;
+
+   struct Minus { template <typename T> static T apply(T a, T b) { return a - b; } };
+   struct Plus  { template <typename T> static T apply(T a, T b) { return a + b; } };
+}
+
+
+/** Element-wise a op b.
+ */
+template <typename L, typename R, typename Op>
+class VectorBinary : public VectorExpression<VectorBinary<L, R, Op>>
+{
+private:
+   L l_;
+   R r_;
+
+public:
+   using value_type = typename L::value_type;
+
+   static_assert(std::is_same_v<value_type, typename R::value_type>);
+
+   VectorBinary(L l, R r) : l_(std::move(l)), r_(std::move(r)) { assert(l_.size() == r_.size()); };
+
+   value_type operator[](size_t i) const { return Op::apply(l_[i], r_[i]); };
+   size_t     size()               const { return l_.size(); };
+};
+
+
+/** s * a.
+ */
+template <typename E>
+class VectorScaled : public VectorExpression<VectorScaled<E>>
+{
+private:
+   typename E::value_type s_;
+   E                      e_;
+
+public:
+   using value_type = typename E::value_type;
+
+   VectorScaled(value_type s, E e) : s_(s), e_(std::move(e)) {};
+
+   value_type operator[](size_t i) const { return s_ * e_[i]; };
+   size_t     size()               const { return e_.size(); };
+};
+
+
+/** A * x, element i is the vectorized dot product of row i of A with x.
+ *  M is either Matrix<T> const& or, for a temporary matrix, Matrix<T>.
+ */
+template <typename M, typename X>
+class MatrixVectorProduct : public VectorExpression<MatrixVectorProduct<M, X>>
+{
+public:
+   using value_type = typename X::value_type;
+
+   static_assert(std::is_same_v<std::decay_t<M>, Matrix<value_type>>);
+
+private:
+   M a_;
+   X x_;
+
+public:
+   template <typename A>
+   MatrixVectorProduct(A&& a, X x) : a_(std::forward<A>(a)), x_(std::move(x)) { assert(a_.size() == x_.size()); }
+
+   value_type operator[](size_t i) const { return dot_kernel(&a_(i, 0), x_.data(), x_.size()); };
+   size_t     size()               const { return x_.size(); };
+};
+
+
+template <typename A, typename B, typename = std::enable_if_t<vector_expression_detail::is_operand_v<A> and vector_expression_detail::is_operand_v<B>>>
+auto operator-(A&& a, B&& b)
+{
+   using namespace vector_expression_detail;
+
+   return VectorBinary<leaf_t<A>, leaf_t<B>, Minus>(leaf_t<A>(std::forward<A>(a)), leaf_t<B>(std::forward<B>(b)));
+}
+
+
+template <typename A, typename B, typename = std::enable_if_t<vector_expression_detail::is_operand_v<A> and vector_expression_detail::is_operand_v<B>>>
+auto operator+(A&& a, B&& b)
+{
+   using namespace vector_expression_detail;
+
+   return VectorBinary<leaf_t<A>, leaf_t<B>, Plus>(leaf_t<A>(std::forward<A>(a)), leaf_t<B>(std::forward<B>(b)));
+}
+
+
+template <typename A, typename = std::enable_if_t<vector_expression_detail::is_operand_v<A>>>
+auto operator*(vector_expression_detail::value_t<A> const s, A&& a)
+{
+   using namespace vector_expression_detail;
+
+   return VectorScaled<leaf_t<A>>(s, leaf_t<A>(std::forward<A>(a)));
+}
+
+
+// r = A * x
+template <typename M, typename X, typename = std::enable_if_t<vector_expression_detail::is_matrix<std::decay_t<M>>::value and vector_expression_detail::is_operand_v<X>>>
+auto operator*(M&& a, X&& x)
+{
+   using namespace vector_expression_detail;
+
+   using T = value_t<X>;
+
+   // x is evaluated first, since the dot products need it as an array
+   if constexpr (is_expression_v<X>)
+      return MatrixVectorProduct<matrix_leaf_t<M>, VectorValue<T>>(std::forward<M>(a), VectorValue<T>(std::vector<T>(x)));
+   else
+      return MatrixVectorProduct<matrix_leaf_t<M>, leaf_t<X>>(std::forward<M>(a), leaf_t<X>(std::forward<X>(x)));
+}
+
+
+template <typename E>
+typename E::value_type max_norm(VectorExpression<E> const& expr)
+{
+   using T = typename E::value_type;
+
+   T max_x = 0.0;
+
+   expr.for_each_block([&max_x](T const* x, size_t n) { max_x = std::max(max_x, max_abs_kernel(x, n)); });
+
+   return max_x;
+}
+
+
+template <typename E>
+typename E::value_type two_norm(VectorExpression<E> const& expr)
+{
+   using T = typename E::value_type;
+
+   T sum = 0.0;
+
+   expr.for_each_block([&sum](T const* x, size_t n) { sum += sum_squares_kernel(x, n); });
+
+   return squareroot(sum);
+}
+
+#endif // !VECTOR_EXPRESSION_HPP
@@ -0,0 +1,174 @@
+/**
+ \file      vector_kernels.hpp
+ \brief     Vectorized kernels for vector operations and the matrix-vector product.
+ \author    Thorsten Koch
+ \version   1.0
+ \date      15Dec2022
+
+ The float and double versions use GCC vector extensions of 64 bytes. They are
+ compiled for AVX-512, AVX2 and the baseline instruction set; which one is used
+ is decided once at program start for the CPU at hand (GCC target_clones).
+ All other types, like long double and __float128, use the scalar templates.
+*/
+
+#ifndef VECTOR_KERNELS_HPP
+#define VECTOR_KERNELS_HPP
+
+#include <cstddef>
+#include <cstring>
+
+#include "squareroot.hpp"
+
+#define VECTOR_KERNEL_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#define VECTOR_KERNEL_INLINE __attribute__((always_inline))
+
+// Passing vec by value would differ between the clones, but all helpers below are always inlined
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+/** Vector of 64 bytes, one AVX-512 register.
+ */
+template <typename T>
+struct WideSimd
+{
+   typedef T vec __attribute__((vector_size(64)));
+   static constexpr size_t width = 64 / sizeof(T);
+
+   // Inlined into the callers, such that they are compiled for the instruction set of the caller
+   VECTOR_KERNEL_INLINE static vec  load(T const* p)    { vec v; std::memcpy(&v, p, sizeof(v)); return v; };
+   VECTOR_KERNEL_INLINE static void store(T* p, vec const& v){ std::memcpy(p, &v, sizeof(v)); };
+   VECTOR_KERNEL_INLINE static T    sum(vec const& v)        { T s = 0.0; for(size_t k = 0; k < width; k++) s += v[k]; return s; };
+   VECTOR_KERNEL_INLINE static T    max(vec const& v)        { T m = 0.0; for(size_t k = 0; k < width; k++) m = v[k] > m ? v[k] : m; return m; };
+};
+
+
+/** Generic versions, also used for long double and __float128.
+ */
+template <typename T>
+T dot_kernel(T const* const a, T const* const b, size_t const n)
+{
+   T sum = 0.0;
+
+   for(size_t i = 0; i < n; i++)
+      sum += a[i] * b[i];
+
+   return sum;
+}
+
+
+template <typename T>
+T sum_squares_kernel(T const* const a, size_t const n)
+{
+   T sum = 0.0;
+
+   for(size_t i = 0; i < n; i++)
+      sum += a[i] * a[i];
+
+   return sum;
+}
+
+
+template <typename T>
+T max_abs_kernel(T const* const a, size_t const n)
+{
+   T max_a = 0.0;
+
+   for(size_t i = 0; i < n; i++)
+      if (T abs_a = absval(a[i]); abs_a > max_a)
+         max_a = abs_a;
+
+   return max_a;
+}
+
+
+// r = a - b
+template <typename T>
+void subtract_kernel(T const* const a, T const* const b, T* const r, size_t const n)
+{
+   for(size_t i = 0; i < n; i++)
+      r[i] = a[i] - b[i];
+}
+
+
+/** Vectorized versions. Two accumulators hide the latency of the additions.
+ */
+template <typename T>
+VECTOR_KERNEL_INLINE inline T dot_simd(T const* const a, T const* const b, size_t const n)
+{
+   using S = WideSimd<T>;
+
+   typename S::vec acc0 = {};
+   typename S::vec acc1 = {};
+   size_t          i    = 0;
+
+   for(; i + 2 * S::width <= n; i += 2 * S::width)
+   {
+      acc0 += S::load(a + i)            * S::load(b + i);
+      acc1 += S::load(a + i + S::width) * S::load(b + i + S::width);
+   }
+   if (i + S::width <= n)
+   {
+      acc0 += S::load(a + i) * S::load(b + i);
+      i    += S::width;
+   }
+   T sum = S::sum(acc0 + acc1);
+
+   for(; i < n; i++)
+      sum += a[i] * b[i];
+
+   return sum;
+}
+
+
+template <typename T>
+VECTOR_KERNEL_INLINE inline T max_abs_simd(T const* const a, size_t const n)
+{
+   using S = WideSimd<T>;
+
+   typename S::vec max_v = {};
+   size_t          i     = 0;
+
+   for(; i + S::width <= n; i += S::width)
+   {
+      auto const v     = S::load(a + i);
+      auto const abs_v = v < 0 ? -v : v;
+
+      max_v = abs_v > max_v ? abs_v : max_v;
+   }
+   T max_a = S::max(max_v);
+
+   for(; i < n; i++)
+      if (T abs_a = absval(a[i]); abs_a > max_a)
+         max_a = abs_a;
+
+   return max_a;
+}
+
+
+template <typename T>
+VECTOR_KERNEL_INLINE inline void subtract_simd(T const* const a, T const* const b, T* const r, size_t const n)
+{
+   using S = WideSimd<T>;
+
+   size_t i = 0;
+
+   for(; i + S::width <= n; i += S::width)
+      S::store(r + i, S::load(a + i) - S::load(b + i));
+
+   for(; i < n; i++)
+      r[i] = a[i] - b[i];
+}
+
+
+#pragma GCC diagnostic pop
+
+VECTOR_KERNEL_CLONES inline float  dot_kernel(float const* a, float const* b, size_t n)    { return dot_simd(a, b, n); }
+VECTOR_KERNEL_CLONES inline double dot_kernel(double const* a, double const* b, size_t n)  { return dot_simd(a, b, n); }
+VECTOR_KERNEL_CLONES inline float  sum_squares_kernel(float const* a, size_t n)            { return dot_simd(a, a, n); }
+VECTOR_KERNEL_CLONES inline double sum_squares_kernel(double const* a, size_t n)           { return dot_simd(a, a, n); }
+VECTOR_KERNEL_CLONES inline float  max_abs_kernel(float const* a, size_t n)                { return max_abs_simd(a, n); }
+VECTOR_KERNEL_CLONES inline double max_abs_kernel(double const* a, size_t n)               { return max_abs_simd(a, n); }
+VECTOR_KERNEL_CLONES inline void   subtract_kernel(float const* a, float const* b, float* r, size_t n)    { subtract_simd(a, b, r, n); }
+VECTOR_KERNEL_CLONES inline void   subtract_kernel(double const* a, double const* b, double* r, size_t n) { subtract_simd(a, b, r, n); }
+
+#endif // !VECTOR_KERNELS_HPP